@@ -9,7 +9,7 @@ namespace game {
     class Audio {
         public:
             // Constructors
-            Audio(const EntityPool& entityPool) : _entityPool{entityPool} {}
+            Audio(EntityPool& entityPool) : _entityPool{entityPool} {}
 
             // Functions
             void loadSounds();
@@ -17,7 +17,7 @@ namespace game {
 
             SoundInstance* playSound(const std::string& id);
         private:
-            EntityPool _entityPool;
+            EntityPool& _entityPool;
             SoundPool _instancePool{_entityPool, 16};
             std::unordered_map<std::string, Sound> _sounds;
     };
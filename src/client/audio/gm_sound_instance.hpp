@@ -3,9 +3,9 @@
 #include "gm_sound.hpp"
 
 #include <common/headers/float.hpp>
+#include <server/components/gm_component_pool.hpp>
 #include <server/entities/gm_entity.hpp>
 
-#include <unordered_map>
 #include <vector>
 
 namespace game {
@@ -31,24 +31,10 @@ namespace game {
             size_t _position = 0; // Position in sound data
     };
     
-    class SoundPool {
+    class SoundPool : public ComponentPool<SoundInstance> {
         public:
             // Constructors
             SoundPool(EntityPool& entityPool, const size_t initialCapacity)
-                : _entityPool{entityPool}, _initialCapacity{initialCapacity} {}
-
-            // Functions
-            void create(const Entity entity);
-            void destroy(const size_t index);
-            SoundInstance& get(const Entity entity) { return _pool[_indexMap[entity]]; }
-            size_t size() const { return _size; };
-
-        private:
-            // Variables
-            EntityPool& _entityPool;
-            size_t _initialCapacity;
-            std::unordered_map<Entity, size_t> _indexMap;
-            std::vector<SoundInstance> _pool{_initialCapacity};
-            size_t _size = 0;
+                : ComponentPool{entityPool, initialCapacity} {}
     };
 }
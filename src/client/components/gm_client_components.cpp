@@ -1,7 +1,7 @@
 #include "gm_client_components.hpp"
 
 namespace game {
-    void ClientComponents::render(const float128_t lag) {
-        render_.render(lag);
+    void ClientComponents::render(const float128_t lag, const TransformPool& transforms) {
+        render_.render(lag, transforms);
     }
 }
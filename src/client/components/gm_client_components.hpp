@@ -9,10 +9,10 @@ namespace game {
     class ClientComponents {
         public:
             // Constructors
-            ClientComponents(EntityPool entityPool) : _entityPool{entityPool} {}
+            ClientComponents(EntityPool& entityPool) : _entityPool{entityPool} {}
         
             // Functions
-            void render(const float128_t lag);
+            void render(const float128_t lag, const TransformPool& transforms);
             
             RenderPool& ai() { return render_; }
             
@@ -1,11 +1,11 @@
 #pragma once
 
 #include <common/headers/float.hpp>
-#include <server/components/gm_physics_component.hpp>
+#include <server/components/gm_component_pool.hpp>
+#include <server/components/gm_transform_component.hpp>
 #include <server/entities/gm_entity.hpp>
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace game {
@@ -15,7 +15,8 @@ namespace game {
             RenderComponent(const Entity entity);
 
             // Functions
-            void render(const float128_t lag, const WorldTransform& parentTransform, bool dirty);
+            // @p transform is the entity's world transform, dirty if it changed this tick
+            void render(const float128_t lag, const WorldTransform& transform);
 
             Entity entity() const { return _entity; }
         
@@ -24,26 +25,13 @@ namespace game {
             Entity _entity;
     };
     
-    class RenderPool {
+    class RenderPool : public ComponentPool<RenderComponent> {
         public:
             // Constructors
             RenderPool(EntityPool& entityPool, const size_t initialCapacity)
-                : _entityPool{entityPool}, _initialCapacity{initialCapacity} {}
+                : ComponentPool{entityPool, initialCapacity} {}
 
             // Functions
-            void create(const Entity entity);
-            void destroy(const size_t index);
-            RenderComponent& get(const Entity entity) { return _pool[_indexMap[entity]]; }
-            size_t size() const { return _size; };
-
-            void render(const float128_t lag);
-
-        private:
-            // Variables
-            EntityPool& _entityPool;
-            size_t _initialCapacity;
-            std::unordered_map<Entity, size_t> _indexMap;
-            std::vector<RenderComponent> _pool{_initialCapacity};
-            size_t _size = 0;
+            void render(const float128_t lag, const TransformPool& transforms);
     };
 }
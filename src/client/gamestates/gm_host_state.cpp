@@ -23,7 +23,7 @@ namespace game {
         renderer.beginSwapChainRenderPass(commandBuffer);
 
         // Render world
-        _clientComponents.render(lag);
+        _clientComponents.render(lag, _server.world().serverComponents().transform());
 
         renderer.endSwapChainRenderPass(commandBuffer);
         renderer.endFrame();
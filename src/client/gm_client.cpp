@@ -6,6 +6,8 @@
 #include "graphics/vulkan/gm_swap_chain.hpp"
 
 #include <common/data/file/gm_logger.hpp>
+#include <common/system/gm_profiler.hpp>
+#include <common/system/gm_tick_clock.hpp>
 
 #include <thread>
 
@@ -64,33 +66,30 @@ namespace game {
         _window.show();
 
         // Main game loop
-        auto previousTime = std::chrono::high_resolution_clock::now();
-        float128_t lag = 0.0f;
+        TickClock clock{std::chrono::milliseconds(Core::MS_PER_TICK)};
         while (Core::running && !_window.shouldClose()) {
             glfwPollEvents();
 
-            auto currentTime = std::chrono::high_resolution_clock::now();
-            float128_t elapsedTime = std::chrono::duration<float128_t, std::chrono::milliseconds::period>(currentTime - previousTime).count();
-            previousTime = currentTime;
-            lag += elapsedTime;
-
             // Prioritize game update when behind, skip to rendering when ahead
-            while (lag >= Core::MS_PER_TICK) {
+            while (clock.tick()) {
                 if (_nextGameState) {
                     delete _gameState;
                     _gameState = _nextGameState;
                     _nextGameState = nullptr;
-                    previousTime = std::chrono::high_resolution_clock::now();
+                    clock.reset();
                 }
 
+                PROFILE_ZONE("Client::update");
                 _gameState->update();
-                lag -= Core::MS_PER_TICK;
             }
 
             // Render object positions between ticks (input is percentage of next tick)
             // Example: Bullet is on left of screen on tick 1, and right on tick two, but render happens
             // at tick 1.5. Input is 0.5, meaning the bullet should render in the middle of the screen.
-            _gameState->render(lag / Core::MS_PER_TICK);
+            {
+                PROFILE_ZONE("Client::render");
+                _gameState->render(clock.alpha());
+            }
         }
 
         // Unload game
@@ -17,7 +17,7 @@ namespace game {
 
     void Camera::update(const float128_t lag) {
         if (_window.wasResized()) updatePerspective();
-        if (_world.serverComponents().transform().get(_entity).dirty()) updateView();
+        if (_world.serverComponents().transform().dirty(_entity)) updateView();
     }
 
     void Camera::updatePerspective() {
@@ -1,45 +1,136 @@
 #include "gm_bkv_builder.hpp"
 
+#include "../../headers/string.hpp"
+
+#include <stdexcept>
+
 namespace game {
-    template<typename T>
-    void BKV_Builder::setInt(BKV_t& bkv, const UTF8Str& key, const T  value) {
-        // TODO
+    void BKV_Builder::reset() {
+        _buffer.reset();
+        _depth = std::stack<int64_t>();
+
+        // Root compound, which has an empty key
+        const uint8_t root[] = {BKV::BKV_COMPOUND, 0};
+        writeBytes(root, sizeof(root));
+        _depth.push(_buffer._head);
+        reserve(BKV::BKV_COMPOUND_SIZE);
+        _buffer._head += BKV::BKV_COMPOUND_SIZE;
     }
 
-    template<typename T>
-    void BKV_Builder::setIntList(BKV_t& bkv, const UTF8Str& key, const T* value, const uint32_t size) {
-        
-    }
+    BKV_t BKV_Builder::build() {
+        while (!_depth.empty()) closeCompound();
 
-    void BKV_Builder::setFloat(BKV_t& bkv, const UTF8Str& key, const float32_t value) {
+        uint8_t* buffer = static_cast<uint8_t*>(std::malloc(_buffer._head));
+        std::memcpy(buffer, _buffer._bkv, _buffer._head);
+        std::shared_ptr<const uint8_t> data(buffer, std::free);
+        const int64_t size = _buffer._head;
 
+        reset();
+        return BKV_t{size, data};
     }
 
-    void BKV_Builder::setFloatList(BKV_t& bkv, const UTF8Str& key, const float32_t* value) {
+    void BKV_Builder::openCompound(const char*__restrict__ key) {
+        if (_depth.size() >= BKV::BKV_COMPOUND_DEPTH_MAX) {
+            UTF8Str msg = FormatString::formatString("Reached maximum BKV compound depth at key: %s", key);
+            throw std::runtime_error(msg.get());
+        }
 
+        writeKey(BKV::BKV_COMPOUND, key);
+        _depth.push(_buffer._head);
+        reserve(BKV::BKV_COMPOUND_SIZE);
+        _buffer._head += BKV::BKV_COMPOUND_SIZE;
     }
 
-    void BKV_Builder::setDouble(BKV_t& bkv, const UTF8Str& key, const float128_t value) {
+    void BKV_Builder::closeCompound() {
+        const uint8_t end = BKV::BKV_END;
+        writeBytes(&end, sizeof(end));
+
+        // Same size as BKV_Parser records for compounds
+        const int64_t size = _buffer._head - _depth.top() + BKV::BKV_COMPOUND_SIZE;
+        if (size > BKV::BKV_COMPOUND_MAX) {
+            UTF8Str msg = FormatString::formatString("BKV compound bigger than maximum size: %ld/%ld", size, BKV::BKV_COMPOUND_MAX);
+            throw std::runtime_error(msg.get());
+        }
+        const uint32_t len = Endianness::hton(static_cast<uint32_t>(size));
+        std::memcpy(_buffer._bkv + _depth.top(), &len, BKV::BKV_COMPOUND_SIZE);
+        _depth.pop();
+    }
 
+    void BKV_Builder::setFloat(const char*__restrict__ key, const float32_t value) {
+        writeKey(BKV::BKV_FLOAT, key);
+        const float32_t swapped = Endianness::htonf(value);
+        writeBytes(&swapped, sizeof(swapped));
     }
 
-    void BKV_Builder::setDoubleList(BKV_t& bkv, const UTF8Str& key, const float128_t* value) {
+    void BKV_Builder::setFloatList(const char*__restrict__ key, const float32_t*__restrict__ values, const uint16_t size) {
+        writeKey(BKV::BKV_FLOAT_ARRAY, key);
+        writeValue(size);
+        for (uint16_t i = 0; i < size; i++) {
+            const float32_t swapped = Endianness::htonf(values[i]);
+            writeBytes(&swapped, sizeof(swapped));
+        }
+    }
 
+    void BKV_Builder::setDouble(const char*__restrict__ key, const float64_t value) {
+        writeKey(BKV::BKV_DOUBLE, key);
+        const float64_t swapped = Endianness::htonf(value);
+        writeBytes(&swapped, sizeof(swapped));
     }
 
-    void BKV_Builder::setBool(BKV_t& bkv, const UTF8Str& key, const bool value) {
+    void BKV_Builder::setDoubleList(const char*__restrict__ key, const float64_t*__restrict__ values, const uint16_t size) {
+        writeKey(BKV::BKV_DOUBLE_ARRAY, key);
+        writeValue(size);
+        for (uint16_t i = 0; i < size; i++) {
+            const float64_t swapped = Endianness::htonf(values[i]);
+            writeBytes(&swapped, sizeof(swapped));
+        }
+    }
 
+    void BKV_Builder::setBool(const char*__restrict__ key, const bool value) {
+        writeKey(BKV::BKV_BOOL, key);
+        const uint8_t byte = value;
+        writeBytes(&byte, sizeof(byte));
     }
 
-    void BKV_Builder::setBoolList(BKV_t& bkv, const UTF8Str& key, const bool* value) {
+    void BKV_Builder::setBoolList(const char*__restrict__ key, const bool*__restrict__ values, const uint16_t size) {
+        writeKey(static_cast<uint8_t>(BKV::BKV_BOOL) | BKV::BKV_ARRAY, key);
+        writeValue(size);
+        for (uint16_t i = 0; i < size; i++) {
+            const uint8_t byte = values[i];
+            writeBytes(&byte, sizeof(byte));
+        }
+    }
 
+    void BKV_Builder::setStr(const char*__restrict__ key, const UTF8Str& value) {
+        writeKey(BKV::BKV_STR, key);
+        writeStr(value);
     }
 
-    void BKV_Builder::setStr(BKV_t& bkv, const UTF8Str& key, const UTF8Str& value) {
-        
+    void BKV_Builder::setStrList(const char*__restrict__ key, const UTF8Str*__restrict__ values, const uint16_t size) {
+        writeKey(BKV::BKV_STR_ARRAY, key);
+        writeValue(size);
+        for (uint16_t i = 0; i < size; i++) writeStr(values[i]);
     }
 
-    void BKV_Builder::setStrList(BKV_t& bkv, const UTF8Str& key, const UTF8Str* value, const uint16_t size) {
-        
+    void BKV_Builder::writeKey(const uint8_t tag, const char*__restrict__ key) {
+        const size_t len = std::strlen(key);
+        if (len > BKV::BKV_KEY_MAX) {
+            UTF8Str msg = FormatString::formatString("BKV key is too long: %lu/%u", len, BKV::BKV_KEY_MAX);
+            throw std::runtime_error(msg.get());
+        }
+
+        const uint8_t header[] = {tag, static_cast<uint8_t>(len)};
+        writeBytes(header, sizeof(header));
+        writeBytes(key, len);
+    }
+
+    void BKV_Builder::writeStr(const UTF8Str& value) {
+        if (value.length() > BKV::BKV_STR_MAX) {
+            UTF8Str msg = FormatString::formatString("BKV string is too long: %ld/%u", value.length(), BKV::BKV_STR_MAX);
+            throw std::runtime_error(msg.get());
+        }
+
+        writeValue(static_cast<uint16_t>(value.length()));
+        writeBytes(value.get(), value.length());
     }
 }
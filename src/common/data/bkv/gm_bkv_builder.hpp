@@ -3,34 +3,73 @@
 #include "gm_bkv.hpp"
 #include "gm_bkv_buffer.hpp"
 
+#include "../gm_endianness.hpp"
 #include "../../headers/float.hpp"
 
+#include <cstring>
+#include <stack>
+
 namespace game {
+    // Writes BKV directly, without going through SBKV. The builder starts inside an unnamed root compound, and
+    // build() closes it along with any compound left open.
+    // Keys are at most BKV_KEY_MAX bytes, and lists at most BKV_ARRAY_MAX values.
     class BKV_Builder {
         public:
+            // Constructors
+            BKV_Builder() { reset(); }
+
+            BKV_Builder(const BKV_Builder &) = delete;
+            BKV_Builder &operator=(const BKV_Builder &) = delete;
+
             // Functions
-            BKV_t build() {
-                uint8_t* buffer = static_cast<uint8_t*>(std::malloc(_buffer._head));
-                std::memcpy(buffer, _buffer._bkv, _buffer._head);
-                std::shared_ptr<const uint8_t> data(buffer, std::free);
-                return BKV_t{_buffer._head, data};
-            }
+            // Closes every open compound and returns the finished BKV, leaving the builder empty for the next one.
+            BKV_t build();
+
+            void openCompound(const char*__restrict__ key);
+            void closeCompound();
 
             template<typename T>
-            void setInt(BKV_t& bkv, const UTF8Str& key, const T  value);
+            void setInt(const char*__restrict__ key, const T value) {
+                writeKey(BKV::BKVTypeMap<T>::tagID, key);
+                writeValue(value);
+            }
             template<typename T>
-            void setIntList(BKV_t& bkv, const UTF8Str& key, const T* value, const uint32_t size);
-            void setFloat(BKV_t& bkv, const UTF8Str& key, const float32_t value);
-            void setFloatList(BKV_t& bkv, const UTF8Str& key, const float32_t* value);
-            void setDouble(BKV_t& bkv, const UTF8Str& key, const float128_t value);
-            void setDoubleList(BKV_t& bkv, const UTF8Str& key, const float128_t* value);
-            void setBool(BKV_t& bkv, const UTF8Str& key, const bool value);
-            void setBoolList(BKV_t& bkv, const UTF8Str& key, const bool* value);
-            void setStr(BKV_t& bkv, const UTF8Str& key, const UTF8Str& value);
-            void setStrList(BKV_t& bkv, const UTF8Str& key, const UTF8Str* value, const uint16_t size);
-        
+            void setIntList(const char*__restrict__ key, const T*__restrict__ values, const uint16_t size) {
+                writeKey(BKV::BKVTypeMap<T>::tagID | BKV::BKV_ARRAY, key);
+                writeValue(size);
+                reserve(static_cast<int64_t>(size) * sizeof(T));
+                for (uint16_t i = 0; i < size; i++) writeValue(values[i]);
+            }
+            void setFloat(const char*__restrict__ key, const float32_t value);
+            void setFloatList(const char*__restrict__ key, const float32_t*__restrict__ values, const uint16_t size);
+            void setDouble(const char*__restrict__ key, const float64_t value);
+            void setDoubleList(const char*__restrict__ key, const float64_t*__restrict__ values, const uint16_t size);
+            void setBool(const char*__restrict__ key, const bool value);
+            void setBoolList(const char*__restrict__ key, const bool*__restrict__ values, const uint16_t size);
+            void setStr(const char*__restrict__ key, const UTF8Str& value);
+            void setStrList(const char*__restrict__ key, const UTF8Str*__restrict__ values, const uint16_t size);
+
         private:
+            // Functions
+            void reset();
+            void reserve(const int64_t len) {
+                StringBuffer::checkResize(_buffer._bkv, _buffer._head + len, _buffer._head, _buffer._capacity);
+            }
+            void writeBytes(const void*__restrict__ data, const int64_t len) {
+                reserve(len);
+                std::memcpy(_buffer._bkv + _buffer._head, data, len);
+                _buffer._head += len;
+            }
+            template<typename T>
+            void writeValue(const T value) {
+                const T swapped = Endianness::hton(value);
+                writeBytes(&swapped, sizeof(T));
+            }
+            void writeKey(const uint8_t tag, const char*__restrict__ key);
+            void writeStr(const UTF8Str& value);
+
             // Variables
             BKV_Buffer _buffer;
+            std::stack<int64_t> _depth; // Where the size of each open compound goes
     };
 }
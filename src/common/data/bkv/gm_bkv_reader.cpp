@@ -0,0 +1,151 @@
+#include "gm_bkv_reader.hpp"
+
+#include "../../headers/string.hpp"
+
+#include <stdexcept>
+
+namespace game {
+    BKV_Reader::BKV_Reader(const BKV_t& bkv) : _bkv{bkv}, _begin{0}, _end{0} {
+        if (bkv.size() == 0) return;
+
+        // Root compound: tag, key, size, then its tags
+        check(0, 2);
+        if (bkv.get()[0] != BKV::BKV_COMPOUND) throw std::runtime_error("BKV does not start with a compound.");
+        _begin = 2 + bkv.get()[1] + BKV::BKV_COMPOUND_SIZE;
+        _end = skip(BKV::BKV_COMPOUND, 2 + bkv.get()[1]);
+    }
+
+    float32_t BKV_Reader::getFloat(const char*__restrict__ key, const float32_t fallback) const {
+        const int64_t value = find(key, BKV::BKV_FLOAT);
+        if (value < 0) return fallback;
+
+        check(value, sizeof(float32_t));
+        float32_t result;
+        std::memcpy(&result, _bkv.get() + value, sizeof(result));
+        return Endianness::ntohf(result);
+    }
+
+    float64_t BKV_Reader::getDouble(const char*__restrict__ key, const float64_t fallback) const {
+        const int64_t value = find(key, BKV::BKV_DOUBLE);
+        if (value < 0) return fallback;
+
+        check(value, sizeof(float64_t));
+        float64_t result;
+        std::memcpy(&result, _bkv.get() + value, sizeof(result));
+        return Endianness::ntohf(result);
+    }
+
+    std::vector<float64_t> BKV_Reader::getDoubleList(const char*__restrict__ key) const {
+        std::vector<float64_t> values;
+        const int64_t value = find(key, BKV::BKV_DOUBLE_ARRAY);
+        if (value < 0) return values;
+
+        const uint16_t size = readValue<uint16_t>(value);
+        check(value + BKV::BKV_ARRAY_SIZE, static_cast<int64_t>(size) * sizeof(float64_t));
+        values.resize(size);
+        for (uint16_t i = 0; i < size; i++) {
+            std::memcpy(&values[i], _bkv.get() + value + BKV::BKV_ARRAY_SIZE + i * sizeof(float64_t), sizeof(float64_t));
+            values[i] = Endianness::ntohf(values[i]);
+        }
+        return values;
+    }
+
+    bool BKV_Reader::getBool(const char*__restrict__ key, const bool fallback) const {
+        const int64_t value = find(key, BKV::BKV_BOOL);
+        return value < 0 ? fallback : readValue<uint8_t>(value) != 0;
+    }
+
+    UTF8Str BKV_Reader::getStr(const char*__restrict__ key, const UTF8Str& fallback) const {
+        const int64_t value = find(key, BKV::BKV_STR);
+        if (value < 0) return fallback;
+
+        const uint16_t len = readValue<uint16_t>(value);
+        check(value + BKV::BKV_STR_SIZE, len);
+        char* str = static_cast<char*>(std::malloc(len + 1));
+        std::memcpy(str, _bkv.get() + value + BKV::BKV_STR_SIZE, len);
+        str[len] = '\0';
+        return UTF8Str{len, std::shared_ptr<const char>(str, std::free)};
+    }
+
+    BKV_Reader BKV_Reader::getCompound(const char*__restrict__ key) const {
+        const int64_t value = find(key, BKV::BKV_COMPOUND);
+        if (value < 0) return BKV_Reader(_bkv, 0, 0);
+        return BKV_Reader(_bkv, value + BKV::BKV_COMPOUND_SIZE, skip(BKV::BKV_COMPOUND, value));
+    }
+
+    int64_t BKV_Reader::find(const char*__restrict__ key, const int tag) const {
+        const size_t keyLen = std::strlen(key);
+        int64_t offset = _begin;
+        while (offset < _end) {
+            check(offset, 1);
+            const uint8_t entryTag = _bkv.get()[offset];
+            if (entryTag == BKV::BKV_END) break;
+
+            check(offset + 1, 1);
+            const uint8_t entryKeyLen = _bkv.get()[offset + 1];
+            const int64_t value = offset + 2 + entryKeyLen;
+            check(offset + 2, entryKeyLen);
+
+            if (entryKeyLen == keyLen && !std::memcmp(_bkv.get() + offset + 2, key, keyLen)) {
+                return (tag < 0 || entryTag == tag) ? value : -1;
+            }
+            offset = skip(entryTag, value);
+        }
+
+        return -1;
+    }
+
+    int64_t BKV_Reader::skip(const uint8_t tag, const int64_t offset, const uint32_t depth) const {
+        // Sizes of single values, by tag without flags
+        static constexpr int64_t sizes[] = {
+            0, // BKV_END
+            -1, // BKV_COMPOUND
+            1, 1, 2, 4, 8, // BKV_BOOL, BKV_I8, BKV_I16, BKV_I32, BKV_I64
+            4, 8, // BKV_FLOAT, BKV_DOUBLE
+            -1, // BKV_STR
+        };
+
+        const uint8_t type = tag & ~BKV::BKV_FLAGS_ALL;
+        if (type >= sizeof(sizes) / sizeof(sizes[0]) || (type == BKV::BKV_COMPOUND && (tag & BKV::BKV_ARRAY))) {
+            UTF8Str msg = FormatString::formatString("Unknown BKV tag %u at index %ld", tag, offset);
+            throw std::runtime_error(msg.get());
+        }
+
+        if (type == BKV::BKV_COMPOUND) {
+            if (depth >= BKV::BKV_COMPOUND_DEPTH_MAX) {
+                UTF8Str msg = FormatString::formatString("Reached maximum BKV compound depth at index %ld", offset);
+                throw std::runtime_error(msg.get());
+            }
+
+            // Walk the tags rather than trusting the stored size
+            int64_t next = offset + BKV::BKV_COMPOUND_SIZE;
+            while (true) {
+                check(next, 1);
+                const uint8_t entryTag = _bkv.get()[next];
+                if (entryTag == BKV::BKV_END) return next + 1;
+
+                check(next + 1, 1);
+                next = skip(entryTag, next + 2 + _bkv.get()[next + 1], depth + 1);
+            }
+        }
+
+        const int64_t count = (tag & BKV::BKV_ARRAY) ? readValue<uint16_t>(offset) : 1;
+        int64_t next = offset + ((tag & BKV::BKV_ARRAY) ? BKV::BKV_ARRAY_SIZE : 0);
+        if (type == BKV::BKV_STR) {
+            for (int64_t i = 0; i < count; i++) next += BKV::BKV_STR_SIZE + readValue<uint16_t>(next);
+        } else {
+            next += count * sizes[type];
+        }
+        check(offset, next - offset);
+        return next;
+    }
+
+    void BKV_Reader::check(const int64_t offset, const int64_t len) const {
+        if (offset < 0 || len < 0 || offset + len > _bkv.size()) {
+            UTF8Str msg = FormatString::formatString("BKV ends early, reading %ld bytes at index %ld of %ld",
+                len, offset, _bkv.size()
+            );
+            throw std::runtime_error(msg.get());
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "gm_bkv.hpp"
+
+#include "../gm_endianness.hpp"
+#include "../../headers/float.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace game {
+    // Reads values by key from one compound of a BKV, such as one made by BKV_Builder.
+    // Getters return the fallback, or an empty list, if the key is missing or holds a different type. The BKV is
+    // bounds checked as it is walked, and malformed data throws std::runtime_error.
+    class BKV_Reader {
+        public:
+            // Constructors
+            // Reads the root compound of @p bkv.
+            BKV_Reader(const BKV_t& bkv);
+
+            // Functions
+            bool contains(const char*__restrict__ key) const { return find(key, -1) >= 0; }
+
+            template<typename T>
+            T getInt(const char*__restrict__ key, const T fallback) const {
+                const int64_t value = find(key, BKV::BKVTypeMap<T>::tagID);
+                return value < 0 ? fallback : readValue<T>(value);
+            }
+            template<typename T>
+            std::vector<T> getIntList(const char*__restrict__ key) const {
+                std::vector<T> values;
+                const int64_t value = find(key, BKV::BKVTypeMap<T>::tagID | BKV::BKV_ARRAY);
+                if (value < 0) return values;
+
+                const uint16_t size = readValue<uint16_t>(value);
+                values.resize(size);
+                for (uint16_t i = 0; i < size; i++) values[i] = readValue<T>(value + BKV::BKV_ARRAY_SIZE + i * sizeof(T));
+                return values;
+            }
+            float32_t getFloat(const char*__restrict__ key, const float32_t fallback) const;
+            float64_t getDouble(const char*__restrict__ key, const float64_t fallback) const;
+            std::vector<float64_t> getDoubleList(const char*__restrict__ key) const;
+            bool getBool(const char*__restrict__ key, const bool fallback) const;
+            UTF8Str getStr(const char*__restrict__ key, const UTF8Str& fallback) const;
+
+            // @return A reader for the compound at @p key, which is empty if there is none
+            BKV_Reader getCompound(const char*__restrict__ key) const;
+
+        private:
+            // Constructors
+            BKV_Reader(const BKV_t& bkv, const int64_t begin, const int64_t end) : _bkv{bkv}, _begin{begin}, _end{end} {}
+
+            // Functions
+            // @return The offset of the value at @p key if its tag is @p tag (or any tag if @p tag is -1), otherwise -1
+            int64_t find(const char*__restrict__ key, const int tag) const;
+            // @return The offset just after the value of type @p tag at @p offset, inside @p depth compounds
+            int64_t skip(const uint8_t tag, const int64_t offset) const { return skip(tag, offset, 0); }
+            int64_t skip(const uint8_t tag, const int64_t offset, const uint32_t depth) const;
+            void check(const int64_t offset, const int64_t len) const;
+
+            template<typename T>
+            T readValue(const int64_t offset) const {
+                check(offset, sizeof(T));
+                T value;
+                std::memcpy(&value, _bkv.get() + offset, sizeof(T));
+                return Endianness::ntoh(value);
+            }
+
+            // Variables
+            BKV_t _bkv;
+            int64_t _begin; // First tag in the compound
+            int64_t _end; // Just after the compound's end tag
+    };
+}
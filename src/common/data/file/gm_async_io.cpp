@@ -0,0 +1,452 @@
+#include "gm_async_io.hpp"
+
+#include "gm_logger.hpp"
+#include "../../headers/string.hpp"
+#include "../../system/gm_system.hpp"
+#include "../../system/gm_threads.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__)
+  #include <fcntl.h>
+  #include <linux/io_uring.h>
+  #include <sys/eventfd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/syscall.h>
+  #include <sys/uio.h>
+  #include <unistd.h>
+#endif
+
+namespace game {
+    std::mutex AsyncIO::_queueMtx;
+    std::condition_variable AsyncIO::_queueCv;
+    std::deque<AsyncIO::Request> AsyncIO::_queue;
+    std::vector<std::thread> AsyncIO::_threads;
+    std::atomic<bool> AsyncIO::_running = false;
+    bool AsyncIO::_usingIOUring = false;
+
+    void AsyncIO::init() {
+        if (_running) return;
+        _running = true;
+
+#if defined(__linux__)
+        if (initIOUring()) {
+            _usingIOUring = true;
+            _threads.emplace_back(ringLoop);
+            return;
+        }
+        Logger::log(LOG_WARN, "io_uring is unavailable, falling back to blocking file I/O threads.");
+#endif
+
+        const uint32_t threadCount = std::min(System::cpuThreadCount(), FALLBACK_THREADS);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            _threads.emplace_back(fallbackLoop);
+        }
+    }
+
+    void AsyncIO::shutdown() {
+        if (!_running) return;
+
+        // Threads finish every queued request before exiting
+        {
+            std::lock_guard lock(_queueMtx);
+            _running = false;
+        }
+        _queueCv.notify_all();
+#if defined(__linux__)
+        if (_usingIOUring) wakeRing();
+#endif
+
+        for (std::thread& thread : _threads) thread.join();
+        _threads.clear();
+#if defined(__linux__)
+        // Only once the ring thread is gone, since shutdown may still be waking it above
+        if (_usingIOUring) closeIOUring();
+#endif
+    }
+
+    void AsyncIO::submit(std::vector<Request>&& requests) {
+        {
+            // Checked under the lock shutdown() stops the service with, so nothing is queued after the threads left
+            std::unique_lock lock(_queueMtx);
+            if (!_running) {
+                // Not started (or already stopped), so service the requests on this thread, which keeps its own
+                // name and registration
+                lock.unlock();
+                for (Request& request : requests) runBlocking(request);
+                return;
+            }
+            for (Request& request : requests) _queue.push_back(std::move(request));
+        }
+
+#if defined(__linux__)
+        if (_usingIOUring) {
+            wakeRing();
+            return;
+        }
+#endif
+        _queueCv.notify_all();
+    }
+
+    void AsyncIO::complete(Request& request, const File::FileContents& contents, std::exception_ptr error) {
+        if (!request.onComplete) return;
+        try {
+            request.onComplete(contents, error);
+        } catch (std::exception& e) {
+            UTF8Str msg = FormatString::formatString("Exception thrown by file I/O callback for %s: %s",
+                request.path.get(), e.what()
+            );
+            Logger::log(LOG_ERR, msg);
+        }
+    }
+
+    void AsyncIO::runBlocking(Request& request) {
+        try {
+            if (request.operation == ASYNC_READ) {
+                File::FileContents contents = File::readFile(request.path.get());
+                complete(request, contents, nullptr);
+            } else {
+                File::writeFile(request.path.get(), request.contents, request.operation == ASYNC_APPEND);
+                complete(request, request.contents, nullptr);
+            }
+        } catch (std::runtime_error& e) {
+            complete(request, File::FileContents{}, std::current_exception());
+        }
+    }
+
+    void AsyncIO::fallbackLoop() {
+        Threads::registerThread("IO", THREAD_IO);
+
+        while (true) {
+            std::unique_lock lock(_queueMtx);
+            _queueCv.wait(lock, [] { return !_queue.empty() || !_running; });
+            if (_queue.empty()) break;
+
+            Request request = std::move(_queue.front());
+            _queue.pop_front();
+            lock.unlock();
+
+            runBlocking(request);
+        }
+
+        Threads::removeThread();
+    }
+
+#if defined(__linux__)
+    int AsyncIO::_wakeFd = -1;
+
+    // Submission and completion queues shared with the kernel, owned by the ring thread
+    static struct Ring_ {
+        int fd = -1;
+
+        uint32_t* sqHead;
+        uint32_t* sqTail;
+        uint32_t* sqMask;
+        uint32_t* sqArray;
+        uint32_t sqEntries;
+        io_uring_sqe* sqes;
+
+        uint32_t* cqHead;
+        uint32_t* cqTail;
+        uint32_t* cqMask;
+        io_uring_cqe* cqes;
+
+        void* sqPtr = nullptr;
+        size_t sqSize = 0;
+        void* cqPtr = nullptr;
+        size_t cqSize = 0;
+        size_t sqesSize = 0;
+    } ring_;
+
+    // A request in flight in the ring
+    typedef struct RingOperation_ {
+        AsyncIO::Request request;
+        int fd = -1;
+        FILE* file = nullptr; // Temporary file for writes
+        UTF8Str tempPath;
+        uint8_t* buffer = nullptr;
+        size_t length = 0;
+        size_t done = 0;
+        iovec iov;
+    } RingOperation;
+
+    // User data of the eventfd read that wakes the ring thread when requests are queued
+    static constexpr uint64_t WAKE_USER_DATA = 0;
+    static uint64_t wakeValue_;
+    static iovec wakeIov_{&wakeValue_, sizeof(wakeValue_)};
+
+    static inline int ioUringSetup(uint32_t entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static inline int ioUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    bool AsyncIO::initIOUring() {
+        io_uring_params params{};
+        ring_.fd = ioUringSetup(QUEUE_DEPTH, &params);
+        if (ring_.fd < 0) return false;
+
+        // Map the rings (kernels with IORING_FEAT_SINGLE_MMAP share one mapping)
+        ring_.sqSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        ring_.cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) ring_.sqSize = ring_.cqSize = std::max(ring_.sqSize, ring_.cqSize);
+
+        ring_.sqPtr = mmap(nullptr, ring_.sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_.fd, IORING_OFF_SQ_RING);
+        if (ring_.sqPtr == MAP_FAILED) {
+            close(ring_.fd);
+            return false;
+        }
+
+        if (singleMmap) {
+            ring_.cqPtr = ring_.sqPtr;
+        } else {
+            ring_.cqPtr = mmap(nullptr, ring_.cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_.fd, IORING_OFF_CQ_RING);
+            if (ring_.cqPtr == MAP_FAILED) {
+                munmap(ring_.sqPtr, ring_.sqSize);
+                close(ring_.fd);
+                return false;
+            }
+        }
+
+        ring_.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, ring_.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_.fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            if (!singleMmap) munmap(ring_.cqPtr, ring_.cqSize);
+            munmap(ring_.sqPtr, ring_.sqSize);
+            close(ring_.fd);
+            return false;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(ring_.sqPtr);
+        ring_.sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+        ring_.sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+        ring_.sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        ring_.sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+        ring_.sqEntries = params.sq_entries;
+        ring_.sqes = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* cq = static_cast<uint8_t*>(ring_.cqPtr);
+        ring_.cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+        ring_.cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+        ring_.cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+        ring_.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        _wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (_wakeFd < 0) {
+            munmap(sqes, ring_.sqesSize);
+            if (!singleMmap) munmap(ring_.cqPtr, ring_.cqSize);
+            munmap(ring_.sqPtr, ring_.sqSize);
+            close(ring_.fd);
+            return false;
+        }
+
+        return true;
+    }
+
+    void AsyncIO::wakeRing() {
+        uint64_t one = 1;
+        if (write(_wakeFd, &one, sizeof(one)) < 0) {
+            Logger::log(LOG_ERR, "Could not wake file I/O thread.");
+        }
+    }
+
+    // Returns false if the submission queue is full
+    static bool pushSqe(const uint8_t opcode, const int fd, const iovec* iov, const uint64_t offset, const uint64_t userData) {
+        const uint32_t tail = *ring_.sqTail;
+        const uint32_t head = __atomic_load_n(ring_.sqHead, __ATOMIC_ACQUIRE);
+        if (tail - head >= ring_.sqEntries) return false;
+
+        const uint32_t index = tail & *ring_.sqMask;
+        io_uring_sqe* sqe = &ring_.sqes[index];
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(iov);
+        sqe->len = 1;
+        sqe->off = offset;
+        sqe->user_data = userData;
+        ring_.sqArray[index] = index;
+
+        __atomic_store_n(ring_.sqTail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Queues the next read or write for the rest of @p op
+    static bool pushOperation(RingOperation* op) {
+        op->iov.iov_base = op->buffer + op->done;
+        op->iov.iov_len = op->length - op->done;
+        const uint8_t opcode = op->request.operation == AsyncIO::ASYNC_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+        return pushSqe(opcode, op->fd, &op->iov, op->done, reinterpret_cast<uint64_t>(op));
+    }
+
+    // Opens the file for @p op. Returns false if the request completed immediately.
+    static bool openOperation(RingOperation* op) {
+        if (op->request.operation == AsyncIO::ASYNC_READ) {
+            // The lock only covers opening the file: writers replace files by renaming, so an open descriptor
+            // keeps reading a complete file, and the size read below excludes later appends.
+            std::shared_lock lock(File::fileMutex(op->request.path.get()));
+            op->fd = open(op->request.path.get(), O_RDONLY | O_CLOEXEC);
+            if (op->fd < 0) {
+                UTF8Str msg = FormatString::formatString("Could not open file: %s", op->request.path.get());
+                Logger::crash(msg);
+            }
+
+            struct stat st;
+            fstat(op->fd, &st);
+            op->length = static_cast<size_t>(st.st_size);
+            op->buffer = static_cast<uint8_t*>(std::malloc(std::max(op->length, static_cast<size_t>(1))));
+        } else {
+            // Writes go to a temporary file, committed once the write completes
+            op->file = File::openTempFile(op->request.path.get(), op->tempPath);
+            op->fd = fileno(op->file);
+            op->length = op->request.contents.length();
+            op->buffer = const_cast<uint8_t*>(op->request.contents.get());
+        }
+
+        return op->length > 0;
+    }
+
+    static void finishOperation(RingOperation* op, std::exception_ptr error) {
+        File::FileContents contents;
+        if (op->request.operation == AsyncIO::ASYNC_READ) {
+            if (op->fd >= 0) close(op->fd);
+            if (error) {
+                std::free(op->buffer);
+            } else {
+                contents = File::FileContents{op->length, std::shared_ptr<const uint8_t>(op->buffer, std::free)};
+            }
+        } else {
+            if (op->file) std::fclose(op->file);
+            if (!error) {
+                try {
+                    File::commitTempFile(op->request.path.get(), op->tempPath,
+                        op->request.operation == AsyncIO::ASYNC_APPEND
+                    );
+                    contents = op->request.contents;
+                } catch (std::runtime_error& e) {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (op->request.onComplete) {
+            try {
+                op->request.onComplete(contents, error);
+            } catch (std::exception& e) {
+                UTF8Str msg = FormatString::formatString("Exception thrown by file I/O callback for %s: %s",
+                    op->request.path.get(), e.what()
+                );
+                Logger::log(LOG_ERR, msg);
+            }
+        }
+        delete op;
+    }
+
+    void AsyncIO::ringLoop() {
+        Threads::registerThread("IO", THREAD_IO);
+
+        std::deque<RingOperation*> pending; // Opened operations waiting for room in the submission queue
+        uint32_t inFlight = 0;
+        uint32_t toSubmit = 0;
+        bool wakeArmed = false;
+
+        while (true) {
+            // Keep a read on the eventfd queued so submit() can wake this thread
+            if (!wakeArmed && pushSqe(IORING_OP_READV, _wakeFd, &wakeIov_, 0, WAKE_USER_DATA)) {
+                wakeArmed = true;
+                toSubmit++;
+            }
+
+            // Take new requests
+            std::deque<Request> requests;
+            bool running;
+            {
+                std::lock_guard lock(_queueMtx);
+                requests.swap(_queue);
+                running = _running;
+            }
+            for (Request& request : requests) {
+                RingOperation* op = new RingOperation{std::move(request)};
+                try {
+                    if (openOperation(op)) {
+                        pending.push_back(op);
+                    } else {
+                        finishOperation(op, nullptr);
+                    }
+                } catch (std::runtime_error& e) {
+                    finishOperation(op, std::current_exception());
+                }
+            }
+
+            // Queue as much as fits, leaving a slot for the wakeup read
+            while (!pending.empty() && inFlight + 1 < ring_.sqEntries && pushOperation(pending.front())) {
+                pending.pop_front();
+                inFlight++;
+                toSubmit++;
+            }
+
+            if (!running && !inFlight && pending.empty()) break;
+
+            // Submit and wait for at least one completion
+            if (ioUringEnter(ring_.fd, toSubmit, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                Logger::crash("io_uring_enter failed.");
+            }
+            toSubmit = 0;
+
+            // Reap completions
+            uint32_t head = *ring_.cqHead;
+            const uint32_t tail = __atomic_load_n(ring_.cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++) {
+                const io_uring_cqe* cqe = &ring_.cqes[head & *ring_.cqMask];
+                if (cqe->user_data == WAKE_USER_DATA) {
+                    wakeArmed = false;
+                    continue;
+                }
+
+                RingOperation* op = reinterpret_cast<RingOperation*>(cqe->user_data);
+                inFlight--;
+
+                if (cqe->res < 0 || (cqe->res == 0 && op->done < op->length)) {
+                    UTF8Str msg = FormatString::formatString("Error %d during asynchronous I/O on file: %s",
+                        -cqe->res, op->request.path.get()
+                    );
+                    Logger::log(LOG_ERR, msg);
+                    finishOperation(op, std::make_exception_ptr(std::runtime_error(msg.get())));
+                    continue;
+                }
+
+                op->done += static_cast<size_t>(cqe->res);
+                if (op->done < op->length) {
+                    pending.push_front(op); // Short read or write, queue the rest
+                } else {
+                    finishOperation(op, nullptr);
+                }
+            }
+            __atomic_store_n(ring_.cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        Threads::removeThread();
+    }
+
+    void AsyncIO::closeIOUring() {
+        munmap(ring_.sqes, ring_.sqesSize);
+        if (ring_.cqPtr != ring_.sqPtr) munmap(ring_.cqPtr, ring_.cqSize);
+        munmap(ring_.sqPtr, ring_.sqSize);
+        close(ring_.fd);
+        close(_wakeFd);
+        ring_.fd = -1;
+        _wakeFd = -1;
+        _usingIOUring = false;
+    }
+#endif
+}
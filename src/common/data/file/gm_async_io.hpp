@@ -0,0 +1,79 @@
+#pragma once
+
+#include "gm_file.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace game {
+    class AsyncIO {
+        public:
+            // Types
+            enum AsyncIO_Operations {
+                ASYNC_READ,
+                ASYNC_WRITE,
+                ASYNC_APPEND,
+            };
+
+            // Called on an I/O thread when a request finishes. Reads receive the file contents, writes receive
+            // the contents that were written. If the request failed, @p error is set and the contents are empty.
+            typedef std::function<void(const File::FileContents& contents, std::exception_ptr error)> Completion;
+
+            typedef struct Request_ {
+                int operation;
+                UTF8Str path;
+                File::FileContents contents; // Contents to write, unused for reads
+                Completion onComplete;
+            } Request;
+
+            // Functions
+            static void init();
+            static void shutdown();
+
+            // Queues every request in @p requests at once, so they can be submitted to the kernel as one batch.
+            static void submit(std::vector<Request>&& requests);
+            static inline void submit(Request&& request) {
+                std::vector<Request> requests;
+                requests.push_back(std::move(request));
+                submit(std::move(requests));
+            }
+
+            // True if requests are serviced by io_uring, false if they fall back to the blocking thread pool.
+            static bool usingIOUring() { return _usingIOUring; }
+
+            // Variables
+            static constexpr uint32_t QUEUE_DEPTH = 64;
+            static constexpr uint32_t FALLBACK_THREADS = 4;
+
+        private:
+            // Functions
+            static void fallbackLoop();
+            static void runBlocking(Request& request);
+            static void complete(Request& request, const File::FileContents& contents, std::exception_ptr error);
+
+            // Variables
+            static std::mutex _queueMtx;
+            static std::condition_variable _queueCv;
+            static std::deque<Request> _queue;
+            static std::vector<std::thread> _threads;
+            static std::atomic<bool> _running;
+            static bool _usingIOUring;
+
+#if defined(__linux__)
+            // Functions
+            static bool initIOUring();
+            static void closeIOUring();
+            static void ringLoop();
+            static void wakeRing();
+
+            // Variables
+            static int _wakeFd;
+#endif
+    };
+}
@@ -1,16 +1,24 @@
 #include "gm_compression.hpp"
 
 #include "gm_logger.hpp"
+#include "gm_lz4.hpp"
+#include "../gm_endianness.hpp"
 #include "../../gm_core.hpp"
 #include "../../headers/string.hpp"
 #include "../../system/gm_system.hpp"
 
 #include <lzma.h>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
-#include <mutex>
 
 namespace game {
+    // liblzma scales threads by block, and more than 8 gives little benefit at the block sizes used here
+    static inline uint32_t compressionThreads() {
+        return std::clamp(System::cpuThreadCount(), static_cast<uint32_t>(1), static_cast<uint32_t>(8));
+    }
+
     inline void initDecoder(lzma_stream *stream, const char*__restrict__ filepath) {
         // The .xz format allows concatenating compressed files as is:
         //
@@ -28,12 +36,21 @@ namespace game {
         // (src/liblzma/api/lzma/container.h in the source package or e.g.
         // /usr/include/lzma/container.h depending on the install prefix)
         // for details.
-        lzma_ret ret = lzma_stream_decoder(stream, UINT64_MAX, LZMA_CONCATENATED);
+        //
+        // The multithreaded decoder decodes blocks in parallel when the block sizes are stored in the block
+        // headers, which lzma_stream_encoder_mt() always does. Other files fall back to single-threaded decoding.
+        lzma_mt mt{};
+        mt.flags = LZMA_CONCATENATED;
+        mt.threads = compressionThreads();
+        mt.timeout = 0;
+        mt.memlimit_threading = std::max(System::physicalMemory() / 4, static_cast<size_t>(1));
+        mt.memlimit_stop = UINT64_MAX;
+        lzma_ret ret = lzma_stream_decoder_mt(stream, &mt);
 
         if (ret != LZMA_OK) {
             switch (ret) {
                 case LZMA_MEM_ERROR: {
-                    UTF8Str msg = FormatString::formatString("Ran out of memory while decompressing file: %s");
+                    UTF8Str msg = FormatString::formatString("Ran out of memory while decompressing file: %s", filepath);
                     Logger::crash(msg);
                 }
 
@@ -50,107 +67,123 @@ namespace game {
         }
     }
 
-    File::FileContents const Compression::decompressFile(const char*__restrict__ filepath) {
-        lzma_stream stream = LZMA_STREAM_INIT;
-        initDecoder(&stream, filepath);
-	    lzma_action action = LZMA_RUN;
+    [[noreturn]] static void crashDecodeError(const lzma_ret ret, const char*__restrict__ filepath) {
+        switch (ret) {
+            case LZMA_MEM_ERROR: {
+                UTF8Str msg = FormatString::formatString("Ran out of memory while decompressing file: %s", filepath);
+                Logger::crash(msg);
+            }
 
-        // Open file
-        File::_fileMtx.lock();
-        FILE* f = std::fopen(filepath, "rb");
-        if (f == nullptr) {
-            UTF8Str msg = FormatString::formatString("Error opening file: %s", filepath);
-            Logger::crash(msg);
+            case LZMA_DATA_ERROR: {
+                UTF8Str msg = FormatString::formatString("Corrupted data encountered while decompressing file: %s", filepath);
+                Logger::crash(msg);
+            }
+
+            case LZMA_FORMAT_ERROR: {
+                UTF8Str msg = FormatString::formatString("Input file for decompression is not in xz format: %s", filepath);
+                Logger::crash(msg);
+            }
+
+            case LZMA_OPTIONS_ERROR: {
+                UTF8Str msg = FormatString::formatString("Unsupported compression options for file: %s", filepath);
+                Logger::crash(msg);
+            }
+
+            case LZMA_BUF_ERROR: {
+                UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", filepath);
+                Logger::crash(msg);
+            }
+
+            default: {
+                UTF8Str msg = FormatString::formatString("Unknown error occurred while decompressing file: %s", filepath);
+                Logger::crash(msg);
+            }
         }
-        
-        size_t head = 0, c = 0;
-        uint8_t inbuf[BUFSIZ], outbuf[BUFSIZ];
-        size_t capacity = sizeof(inbuf);
-        uint8_t* data = static_cast<uint8_t*>(std::malloc(capacity));
+    }
 
-        stream.next_in = nullptr;
-        stream.avail_in = 0;
-        stream.next_out = outbuf;
-        stream.avail_out = sizeof(outbuf);
+    [[noreturn]] static void crashEncodeError(const lzma_ret ret, const char*__restrict__ filepath) {
+        switch (ret) {
+            case LZMA_MEM_ERROR: {
+                UTF8Str msg = FormatString::formatString("Ran out of memory while compressing file: %s", filepath);
+                Logger::crash(msg);
+            }
 
-        while (true) {
-            // Fill input buffer
-            if (stream.avail_in == 0 && !std::feof(f)) {
-                stream.next_in = inbuf;
-                stream.avail_in = std::fread(inbuf, 1, sizeof(inbuf), f);
+            case LZMA_DATA_ERROR: {
+                UTF8Str msg = FormatString::formatString("File size is greater than maximum (2^63 bytes): %s", filepath);
+                Logger::crash(msg);
+            }
 
-                if (std::feof(f)) action = LZMA_FINISH;
+            default: {
+                UTF8Str msg = FormatString::formatString("Unknown error occurred while compressing file: %s", filepath);
+                Logger::crash(msg);
             }
+        }
+    }
+
+    // Reads the uncompressed size from the index of every stream in @p compressed, or 0 if it is unavailable
+    inline uint64_t uncompressedSize(const File::FileContents& compressed) {
+        lzma_stream stream = LZMA_STREAM_INIT;
+        lzma_index* index = nullptr;
+        if (lzma_file_info_decoder(&stream, &index, UINT64_MAX, compressed.length()) != LZMA_OK) return 0;
+
+        // The whole file is in memory, so the decoder never has to ask for a seek
+        stream.next_in = compressed.get();
+        stream.avail_in = compressed.length();
+        uint64_t size = 0;
+        if (lzma_code(&stream, LZMA_RUN) == LZMA_STREAM_END && index) size = lzma_index_uncompressed_size(index);
+
+        lzma_end(&stream);
+        if (index) lzma_index_end(index, nullptr);
+        return size;
+    }
+
+    static File::FileContents xzDecompress(const File::FileContents& compressed, const char*__restrict__ filepath) {
+        lzma_stream stream = LZMA_STREAM_INIT;
+        initDecoder(&stream, filepath);
+
+        // Decode straight into a buffer of the final size when the index gives it
+        const uint64_t size = uncompressedSize(compressed);
+        size_t capacity = size ? static_cast<size_t>(size) : std::max(compressed.length() * 4, static_cast<size_t>(BUFSIZ));
+        uint8_t* data = static_cast<uint8_t*>(std::malloc(capacity));
 
+        stream.next_in = compressed.get();
+        stream.avail_in = compressed.length();
+        stream.next_out = data;
+        stream.avail_out = capacity;
+
+        // All input is available, so the decoder can be told to finish straight away
+        const lzma_action action = LZMA_FINISH;
+
+        while (true) {
             // Decompress
             lzma_ret ret = lzma_code(&stream, action);
 
-            // Fill output data
-            if (stream.avail_out == 0 || ret == LZMA_STREAM_END) {
-                c = sizeof(outbuf) - stream.avail_out;
-                head += c;
-                
-                // Check if data can fit buffer
-                if (capacity < head) {
-                    capacity = head * 2;
-                    data = static_cast<uint8_t*>(std::realloc(data, capacity));
-                }
-                std::memcpy(data + (head - c), outbuf, c);
-                
-                stream.next_out = outbuf;
-                stream.avail_out = sizeof(outbuf);
+            // Grow the output if the size was unknown, or give the decoder room to finish if it was known
+            if (stream.avail_out == 0 && ret == LZMA_OK) {
+                capacity += size ? BUFSIZ : capacity;
+                data = static_cast<uint8_t*>(std::realloc(data, capacity));
+                stream.next_out = data + stream.total_out;
+                stream.avail_out = capacity - stream.total_out;
             }
 
             if (ret != LZMA_OK) {
                 if (ret == LZMA_STREAM_END) break;
 
-                switch (ret) {
-                    case LZMA_MEM_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Ran out of memory while decompressing file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    case LZMA_DATA_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Corrupted data encountered while decompressing file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    case LZMA_FORMAT_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Input file for decompression is not in xz format: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    case LZMA_OPTIONS_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Unsupported compression options for file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    case LZMA_BUF_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    default: {
-                        UTF8Str msg = FormatString::formatString("Unknown error occurred while decompressing file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-                }
+                crashDecodeError(ret, filepath);
             }
 	    }
 
-        // Close file
-        std::fclose(f);
+        const size_t head = stream.total_out;
 	    lzma_end(&stream);
-        File::_fileMtx.unlock();
-	    data = static_cast<uint8_t*>(std::realloc(data, head));
+	    if (head != capacity) data = static_cast<uint8_t*>(std::realloc(data, std::max(head, static_cast<size_t>(1))));
 
-        return File::FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};;
+        return File::FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};
     }
 
     inline void initEncoder(lzma_stream* stream, const char*__restrict__ filepath) {
         lzma_mt mt = {
             .flags = 0,
-            .threads = std::min(System::cpuThreadCount(), static_cast<uint32_t>(8)),
+            .threads = compressionThreads(),
             .block_size = 0,
             .timeout = 0,
             .preset = File::COMPRESSION_PRESET,
@@ -185,55 +218,32 @@ namespace game {
         }
     }
 
-    void const Compression::compressFile(const char*__restrict__ filepath, const File::FileContents& contents, const bool append) {
+    static File::FileContents xzCompress(const File::FileContents& contents, const char*__restrict__ filepath) {
         lzma_stream stream = LZMA_STREAM_INIT;
         initEncoder(&stream, filepath);
-	    lzma_action action = LZMA_RUN;
 
-        // Open file
-        File::_fileMtx.lock();
-        FILE* f = fopen(filepath, append ? "ab" : "wb");
-        if (f == nullptr) {
-            UTF8Str msg = FormatString::formatString("Error opening file: %s", filepath);
-            Logger::crash(msg);
-        }
+        // Compress straight into a buffer big enough for the worst case
+        size_t capacity = lzma_stream_buffer_bound(contents.length());
+        uint8_t* data = static_cast<uint8_t*>(std::malloc(capacity));
 
-        const size_t len = contents.length();
-        const uint8_t* data = contents.get();
+        stream.next_in = contents.get();
+        stream.avail_in = contents.length();
+        stream.next_out = data;
+        stream.avail_out = capacity;
 
-        size_t head = 0, c = 0;
-        uint8_t buf[BUFSIZ];
-        
-        stream.next_in = nullptr;
-        stream.avail_in = 0;
-        stream.next_out = buf;
-        stream.avail_out = sizeof(buf);
+        // All input is available, so the encoder can be told to finish straight away
+        const lzma_action action = LZMA_FINISH;
 
-        // Compress and write
         while (true) {
-            // Fill the input buffer if it is empty.
-            if (stream.avail_in == 0 && head < len) {
-                c = std::min(sizeof(buf), len - head);
-                stream.next_in = data + head;
-                stream.avail_in = c;
-                head += c;
-
-                if (head >= len) action = LZMA_FINISH;
-            }
-
             // Compress
 		    lzma_ret ret = lzma_code(&stream, action);
-            
-            if (stream.avail_out == 0 || ret == LZMA_STREAM_END) {
-                // When lzma_code() has returned LZMA_STREAM_END, the output buffer is likely to be only
-                // partially full. Calculate how much new data there is to be written to the output file.
-                c = sizeof(buf) - stream.avail_out;
-
-                std::fwrite(buf, 1, c, f);
 
-                // Reset next_out and avail_out.
-                stream.next_out = buf;
-                stream.avail_out = sizeof(buf);
+            // The multithreaded encoder can briefly exceed the single-threaded bound
+            if (stream.avail_out == 0 && ret == LZMA_OK) {
+                capacity += BUFSIZ;
+                data = static_cast<uint8_t*>(std::realloc(data, capacity));
+                stream.next_out = data + stream.total_out;
+                stream.avail_out = capacity - stream.total_out;
             }
 
             if (ret != LZMA_OK) {
@@ -241,28 +251,495 @@ namespace game {
                 // lzma_code() will be LZMA_STREAM_END.
                 if (ret == LZMA_STREAM_END) break;
 
-                switch (ret) {
-                    case LZMA_MEM_ERROR: {
-                        UTF8Str msg = FormatString::formatString("Ran out of memory while compressing file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    case LZMA_DATA_ERROR: {
-                        UTF8Str msg = FormatString::formatString("File size is greater than maximum (2^63 bytes): %s", filepath);
-                        Logger::crash(msg);
-                    }
-
-                    default: {
-                        UTF8Str msg = FormatString::formatString("Unknown error occurred while compressing file: %s", filepath);
-                        Logger::crash(msg);
-                    }
-                }
+                crashEncodeError(ret, filepath);
             }
         }
 
-        // Close file
-        std::fclose(f);
+        const size_t head = stream.total_out;
 	    lzma_end(&stream);
-        File::_fileMtx.unlock();
+	    data = static_cast<uint8_t*>(std::realloc(data, std::max(head, static_cast<size_t>(1))));
+
+        return File::FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};
+    }
+
+    static inline void writeBE32(uint8_t* dst, const uint32_t value) {
+        const uint32_t v = Endianness::hton(value);
+        std::memcpy(dst, &v, sizeof(v));
+    }
+
+    static inline uint32_t readBE32(const uint8_t* src) {
+        uint32_t v;
+        std::memcpy(&v, src, sizeof(v));
+        return Endianness::ntoh(v);
+    }
+
+    static inline uint64_t readBE64(const uint8_t* src) {
+        uint64_t v;
+        std::memcpy(&v, src, sizeof(v));
+        return Endianness::ntoh(v);
+    }
+
+    static void writeFrameHeader(uint8_t* dst, const Compression::Codecs codec, const uint64_t len) {
+        std::memcpy(dst, Compression::FRAME_MAGIC, sizeof(Compression::FRAME_MAGIC));
+        dst[4] = Compression::FRAME_VERSION;
+        dst[5] = static_cast<uint8_t>(codec);
+        dst[6] = 0;
+        dst[7] = 0;
+        const uint64_t size = Endianness::hton(len);
+        std::memcpy(dst + 8, &size, sizeof(size));
+    }
+
+    // Writes the block header and data for @p len bytes of @p src into @p dst, which must hold
+    // FRAME_BLOCK_HEADER_SIZE + LZ4::compressBound(len) bytes.
+    // @return Number of bytes written to @p dst
+    static size_t compressFrameBlock(const uint8_t*__restrict__ src, const size_t len, uint8_t*__restrict__ dst) {
+        uint8_t* data = dst + Compression::FRAME_BLOCK_HEADER_SIZE;
+        size_t stored = LZ4::compress(src, len, data);
+        if (stored >= len) {
+            // Incompressible, store as is
+            std::memcpy(data, src, len);
+            stored = len;
+            writeBE32(dst + 4, static_cast<uint32_t>(stored) | Compression::FRAME_BLOCK_STORED);
+        } else {
+            writeBE32(dst + 4, static_cast<uint32_t>(stored));
+        }
+        writeBE32(dst, static_cast<uint32_t>(len));
+        return Compression::FRAME_BLOCK_HEADER_SIZE + stored;
+    }
+
+    static File::FileContents frameCompress(const File::FileContents& contents, const Compression::Codecs codec) {
+        const size_t len = contents.length();
+        const uint8_t* src = contents.get();
+        const size_t blocks = (len + Compression::FRAME_BLOCK_SIZE - 1) / Compression::FRAME_BLOCK_SIZE;
+        const size_t capacity = Compression::FRAME_HEADER_SIZE + sizeof(uint32_t) +
+            blocks * (Compression::FRAME_BLOCK_HEADER_SIZE + LZ4::compressBound(Compression::FRAME_BLOCK_SIZE));
+        uint8_t* data = static_cast<uint8_t*>(std::malloc(capacity));
+
+        // Header
+        writeFrameHeader(data, codec, len);
+        size_t head = Compression::FRAME_HEADER_SIZE;
+
+        // Blocks
+        for (size_t i = 0; i < len; i += Compression::FRAME_BLOCK_SIZE) {
+            head += compressFrameBlock(src + i, std::min(Compression::FRAME_BLOCK_SIZE, len - i), data + head);
+        }
+
+        // End mark
+        writeBE32(data + head, 0);
+        head += sizeof(uint32_t);
+
+        data = static_cast<uint8_t*>(std::realloc(data, head));
+        return File::FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};
+    }
+
+    // Decodes the frame at @p pos into @p data, growing it as needed, and moves @p pos past the frame
+    static void frameDecompress(const File::FileContents& compressed, size_t& pos,
+        uint8_t*& data, size_t& head, size_t& capacity, const char*__restrict__ name
+    ) {
+        const uint8_t* src = compressed.get();
+        const size_t len = compressed.length();
+        if (len - pos < Compression::FRAME_HEADER_SIZE || src[pos + 4] != Compression::FRAME_VERSION ||
+            src[pos + 5] != Compression::CODEC_LZ4
+        ) {
+            std::free(data);
+            UTF8Str msg = FormatString::formatString("Unsupported compression options for file: %s", name);
+            Logger::crash(msg);
+        }
+
+        // Preallocate the whole frame when its size is known (and plausible, LZ4 cannot expand past 255:1)
+        const uint64_t size = readBE64(src + pos + 8);
+        if (size != UINT64_MAX && size / 255 <= len - pos && capacity < head + size) {
+            capacity = head + size;
+            data = static_cast<uint8_t*>(std::realloc(data, capacity));
+        }
+        pos += Compression::FRAME_HEADER_SIZE;
+
+        while (true) {
+            if (len - pos < sizeof(uint32_t)) break;
+            const uint32_t blockSize = readBE32(src + pos);
+            pos += sizeof(uint32_t);
+            if (!blockSize) return; // End mark
+
+            if (len - pos < sizeof(uint32_t)) break;
+            const uint32_t storedField = readBE32(src + pos);
+            const uint32_t stored = storedField & ~Compression::FRAME_BLOCK_STORED;
+            pos += sizeof(uint32_t);
+            if (len - pos < stored || blockSize > Compression::FRAME_BLOCK_SIZE) break;
+
+            if (capacity < head + blockSize) {
+                capacity = std::max(capacity * 2, head + blockSize);
+                data = static_cast<uint8_t*>(std::realloc(data, capacity));
+            }
+
+            if (storedField & Compression::FRAME_BLOCK_STORED) {
+                if (stored != blockSize) break;
+                std::memcpy(data + head, src + pos, stored);
+            } else if (LZ4::decompress(src + pos, stored, data + head, blockSize) != blockSize) {
+                std::free(data);
+                UTF8Str msg = FormatString::formatString("Corrupted data encountered while decompressing file: %s", name);
+                Logger::crash(msg);
+            }
+            head += blockSize;
+            pos += stored;
+        }
+
+        std::free(data);
+        UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", name);
+        Logger::crash(msg);
+    }
+
+    int Compression::codecOf(const uint8_t* data, const size_t len) {
+        if (len >= sizeof(XZ_MAGIC) && !std::memcmp(data, XZ_MAGIC, sizeof(XZ_MAGIC))) return CODEC_XZ;
+        if (len >= FRAME_HEADER_SIZE && !std::memcmp(data, FRAME_MAGIC, sizeof(FRAME_MAGIC))) return data[5];
+        return -1;
+    }
+
+    File::FileContents Compression::decompress(const File::FileContents& compressed, const char*__restrict__ name) {
+        switch (codecOf(compressed.get(), compressed.length())) {
+            case CODEC_XZ:
+                return xzDecompress(compressed, name);
+
+            case CODEC_LZ4: {
+                size_t pos = 0, head = 0, capacity = 0;
+                uint8_t* data = nullptr;
+                while (pos < compressed.length()) {
+                    frameDecompress(compressed, pos, data, head, capacity, name);
+                }
+                data = static_cast<uint8_t*>(std::realloc(data, std::max(head, static_cast<size_t>(1))));
+                return File::FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};
+            }
+
+            default: {
+                UTF8Str msg = FormatString::formatString("Input file for decompression is not in a known format: %s", name);
+                Logger::crash(msg);
+            }
+        }
+    }
+
+    File::FileContents Compression::compress(const File::FileContents& contents, const Codecs codec, const char*__restrict__ name) {
+        switch (codec) {
+            case CODEC_XZ: return xzCompress(contents, name);
+            case CODEC_LZ4: return frameCompress(contents, codec);
+        }
+
+        UTF8Str msg = FormatString::formatString("Unknown compression codec %d for file: %s", codec, name);
+        Logger::crash(msg);
+    }
+
+    File::FileContents const Compression::decompressFile(const char*__restrict__ filepath) {
+        // Read the compressed file up front so the file lock is not held while decoding
+        return decompress(File::readFile(filepath), filepath);
+    }
+
+    void const Compression::compressFile(const char*__restrict__ filepath, const File::FileContents& contents,
+        const Codecs codec, const bool append
+    ) {
+        // Compress before writing so the file lock is only needed to commit it
+        File::writeFile(filepath, compress(contents, codec, filepath), append);
+    }
+
+    // CompressionWriter //
+    CompressionWriter::CompressionWriter(const char*__restrict__ filepath, const Compression::Codecs codec, const bool append) :
+        _codec{codec}, _append{append}
+    {
+        _path = FormatString::formatString("%s", filepath); // Owned, since callers may pass a temporary
+        _file = File::openTempFile(filepath, _tempPath);
+
+        switch (_codec) {
+            case Compression::CODEC_XZ: {
+                lzma_stream* stream = new lzma_stream{};
+                _lzma = stream;
+                initEncoder(stream, filepath);
+                _buffer = static_cast<uint8_t*>(std::malloc(BUFSIZ));
+                stream->next_out = _buffer;
+                stream->avail_out = BUFSIZ;
+            } break;
+
+            case Compression::CODEC_LZ4: {
+                _buffer = static_cast<uint8_t*>(std::malloc(Compression::FRAME_BLOCK_SIZE));
+                _block = static_cast<uint8_t*>(std::malloc(
+                    Compression::FRAME_BLOCK_HEADER_SIZE + LZ4::compressBound(Compression::FRAME_BLOCK_SIZE)
+                ));
+
+                // The size is not known yet, and is filled in on close()
+                uint8_t header[Compression::FRAME_HEADER_SIZE];
+                writeFrameHeader(header, _codec, UINT64_MAX);
+                std::fwrite(header, 1, sizeof(header), _file);
+            } break;
+
+            default: {
+                std::fclose(_file);
+                _file = nullptr;
+                UTF8Str msg = FormatString::formatString("Unknown compression codec %d for file: %s", codec, filepath);
+                Logger::crash(msg);
+            }
+        }
+    }
+
+    CompressionWriter::~CompressionWriter() {
+        if (_file) {
+            // Not closed, so discard the output
+            std::fclose(_file);
+            std::remove(_tempPath.get());
+        }
+
+        if (_lzma) {
+            lzma_end(static_cast<lzma_stream*>(_lzma));
+            delete static_cast<lzma_stream*>(_lzma);
+        }
+        std::free(_buffer);
+        std::free(_block);
+    }
+
+    void CompressionWriter::write(const uint8_t*__restrict__ data, const size_t len) {
+        if (!_file) {
+            UTF8Str msg = FormatString::formatString("Write to closed compressed file: %s", _path.get());
+            Logger::crash(msg);
+        }
+        _written += len;
+
+        if (_codec == Compression::CODEC_XZ) {
+            lzma_stream* stream = static_cast<lzma_stream*>(_lzma);
+            stream->next_in = data;
+            stream->avail_in = len;
+            while (stream->avail_in) encode(LZMA_RUN);
+            return;
+        }
+
+        // Fill blocks and compress them as they fill up
+        for (size_t head = 0; head < len;) {
+            const size_t c = std::min(Compression::FRAME_BLOCK_SIZE - _bufferLen, len - head);
+            std::memcpy(_buffer + _bufferLen, data + head, c);
+            _bufferLen += c;
+            head += c;
+            if (_bufferLen == Compression::FRAME_BLOCK_SIZE) flushBlock();
+        }
+    }
+
+    void CompressionWriter::write(const BKV_t& bkv) {
+        uint8_t size[sizeof(uint64_t)];
+        const uint64_t len = Endianness::hton(static_cast<uint64_t>(bkv.size()));
+        std::memcpy(size, &len, sizeof(len));
+        write(size, sizeof(size));
+        write(bkv.get(), static_cast<size_t>(bkv.size()));
+    }
+
+    void CompressionWriter::flushBlock() {
+        const size_t c = compressFrameBlock(_buffer, _bufferLen, _block);
+        if (std::fwrite(_block, 1, c, _file) != c) {
+            UTF8Str msg = FormatString::formatString("Could not write file: %s", _tempPath.get());
+            Logger::crash(msg);
+        }
+        _bufferLen = 0;
+    }
+
+    bool CompressionWriter::encode(const int action) {
+        lzma_stream* stream = static_cast<lzma_stream*>(_lzma);
+        lzma_ret ret = lzma_code(stream, static_cast<lzma_action>(action));
+
+        if (stream->avail_out == 0 || ret == LZMA_STREAM_END) {
+            const size_t c = BUFSIZ - stream->avail_out;
+            if (std::fwrite(_buffer, 1, c, _file) != c) {
+                UTF8Str msg = FormatString::formatString("Could not write file: %s", _tempPath.get());
+                Logger::crash(msg);
+            }
+            stream->next_out = _buffer;
+            stream->avail_out = BUFSIZ;
+        }
+
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END) crashEncodeError(ret, _path.get());
+        return ret == LZMA_STREAM_END;
+    }
+
+    void CompressionWriter::close() {
+        if (!_file) return;
+
+        if (_codec == Compression::CODEC_XZ) {
+            lzma_stream* stream = static_cast<lzma_stream*>(_lzma);
+            stream->next_in = nullptr;
+            stream->avail_in = 0;
+            while (!encode(LZMA_FINISH));
+        } else {
+            if (_bufferLen) flushBlock();
+
+            // End mark, then fill in the size in the header
+            uint8_t end[sizeof(uint32_t)];
+            writeBE32(end, 0);
+            std::fwrite(end, 1, sizeof(end), _file);
+
+            const uint64_t size = Endianness::hton(_written);
+            std::fseek(_file, 8, SEEK_SET);
+            std::fwrite(&size, 1, sizeof(size), _file);
+        }
+
+        if (std::fclose(_file)) {
+            _file = nullptr;
+            UTF8Str msg = FormatString::formatString("Could not write file: %s", _tempPath.get());
+            Logger::crash(msg);
+        }
+        _file = nullptr;
+        File::commitTempFile(_path.get(), _tempPath, _append);
+    }
+
+    // CompressionReader //
+    CompressionReader::CompressionReader(const char*__restrict__ filepath) : _lock{File::fileMutex(filepath)} {
+        _path = FormatString::formatString("%s", filepath); // Owned, since callers may pass a temporary
+
+        _file = std::fopen(filepath, "rb");
+        if (!_file) {
+            UTF8Str msg = FormatString::formatString("Could not open file: %s", filepath);
+            Logger::crash(msg);
+        }
+
+        // Detect the codec from the start of the file
+        _in = static_cast<uint8_t*>(std::malloc(std::max(static_cast<size_t>(BUFSIZ), Compression::FRAME_BLOCK_SIZE)));
+        _inLen = std::fread(_in, 1, Compression::FRAME_HEADER_SIZE, _file);
+        _codec = Compression::codecOf(_in, _inLen);
+
+        switch (_codec) {
+            case Compression::CODEC_XZ: {
+                lzma_stream* stream = new lzma_stream{};
+                _lzma = stream;
+                initDecoder(stream, filepath);
+
+                // The header bytes are the first input
+                stream->next_in = _in;
+                stream->avail_in = _inLen;
+            } break;
+
+            case Compression::CODEC_LZ4: {
+                if (_in[4] != Compression::FRAME_VERSION) {
+                    UTF8Str msg = FormatString::formatString("Unsupported compression options for file: %s", filepath);
+                    Logger::crash(msg);
+                }
+                _block = static_cast<uint8_t*>(std::malloc(Compression::FRAME_BLOCK_SIZE));
+            } break;
+
+            default: {
+                UTF8Str msg = FormatString::formatString("Input file for decompression is not in a known format: %s", filepath);
+                Logger::crash(msg);
+            }
+        }
+    }
+
+    CompressionReader::~CompressionReader() {
+        if (_file) std::fclose(_file);
+        if (_lzma) {
+            lzma_end(static_cast<lzma_stream*>(_lzma));
+            delete static_cast<lzma_stream*>(_lzma);
+        }
+        std::free(_in);
+        std::free(_block);
+    }
+
+    size_t CompressionReader::read(uint8_t*__restrict__ data, const size_t len) {
+        if (_eof || !len) return 0;
+
+        if (_codec == Compression::CODEC_XZ) {
+            lzma_stream* stream = static_cast<lzma_stream*>(_lzma);
+            stream->next_out = data;
+            stream->avail_out = len;
+
+            while (stream->avail_out) {
+                // Fill input buffer
+                if (stream->avail_in == 0 && !std::feof(_file)) {
+                    stream->next_in = _in;
+                    stream->avail_in = std::fread(_in, 1, BUFSIZ, _file);
+                }
+
+                lzma_ret ret = lzma_code(stream, std::feof(_file) ? LZMA_FINISH : LZMA_RUN);
+                if (ret == LZMA_STREAM_END) {
+                    _eof = true;
+                    break;
+                }
+                if (ret != LZMA_OK) crashDecodeError(ret, _path.get());
+            }
+
+            return len - stream->avail_out;
+        }
+
+        // Copy out of decompressed blocks
+        size_t head = 0;
+        while (head < len) {
+            if (_blockPos == _blockLen && !readBlock()) {
+                _eof = true;
+                break;
+            }
+
+            const size_t c = std::min(_blockLen - _blockPos, len - head);
+            std::memcpy(data + head, _block + _blockPos, c);
+            _blockPos += c;
+            head += c;
+        }
+        return head;
+    }
+
+    BKV_t CompressionReader::readBKV() {
+        uint8_t size[sizeof(uint64_t)];
+        if (read(size, sizeof(size)) != sizeof(size)) {
+            UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", _path.get());
+            Logger::crash(msg);
+        }
+
+        const size_t len = static_cast<size_t>(readBE64(size));
+        uint8_t* data = static_cast<uint8_t*>(std::malloc(std::max(len, static_cast<size_t>(1))));
+        if (read(data, len) != len) {
+            std::free(data);
+            UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", _path.get());
+            Logger::crash(msg);
+        }
+
+        return BKV_t{static_cast<int64_t>(len), std::shared_ptr<const uint8_t>(data, std::free)};
+    }
+
+    bool CompressionReader::readExact(uint8_t*__restrict__ data, const size_t len) {
+        return std::fread(data, 1, len, _file) == len;
+    }
+
+    bool CompressionReader::readFrameHeader() {
+        uint8_t header[Compression::FRAME_HEADER_SIZE];
+        const size_t c = std::fread(header, 1, sizeof(header), _file);
+        if (c == 0) return false; // No more frames
+
+        if (Compression::codecOf(header, c) != Compression::CODEC_LZ4 || header[4] != Compression::FRAME_VERSION) {
+            UTF8Str msg = FormatString::formatString("Unsupported compression options for file: %s", _path.get());
+            Logger::crash(msg);
+        }
+        return true;
+    }
+
+    bool CompressionReader::readBlock() {
+        uint8_t header[Compression::FRAME_BLOCK_HEADER_SIZE];
+        while (true) {
+            if (!readExact(header, sizeof(uint32_t))) break;
+
+            const uint32_t blockSize = readBE32(header);
+            if (!blockSize) {
+                // End of frame, continue with the next one if it was appended
+                if (!readFrameHeader()) return false;
+                continue;
+            }
+
+            if (!readExact(header + sizeof(uint32_t), sizeof(uint32_t))) break;
+            const uint32_t storedField = readBE32(header + sizeof(uint32_t));
+            const uint32_t stored = storedField & ~Compression::FRAME_BLOCK_STORED;
+            if (blockSize > Compression::FRAME_BLOCK_SIZE || stored > Compression::FRAME_BLOCK_SIZE) break;
+            if (!readExact(_in, stored)) break;
+
+            if (storedField & Compression::FRAME_BLOCK_STORED) {
+                if (stored != blockSize) break;
+                std::memcpy(_block, _in, stored);
+            } else if (LZ4::decompress(_in, stored, _block, blockSize) != blockSize) {
+                UTF8Str msg = FormatString::formatString("Corrupted data encountered while decompressing file: %s", _path.get());
+                Logger::crash(msg);
+            }
+
+            _blockPos = 0;
+            _blockLen = blockSize;
+            return true;
+        }
+
+        UTF8Str msg = FormatString::formatString("Compressed file is truncated or otherwise corrupt: %s", _path.get());
+        Logger::crash(msg);
     }
 }
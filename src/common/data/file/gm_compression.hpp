@@ -1,13 +1,137 @@
 #pragma once
 
 #include "gm_file.hpp"
+#include "../bkv/gm_bkv.hpp"
+
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
 
 namespace game {
     class Compression {
         public:
+            // Types
+            enum Codecs {
+                CODEC_XZ, // Slow with a high ratio, for cold storage
+                CODEC_LZ4, // Hundreds of MB/s, for autosaves, chunks and network payloads
+            };
+
             // Functions
+            // The codec is detected from the data, so files written with any codec can be read back.
             static File::FileContents const decompressFile(const char*__restrict__ filepath);
-            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents) { compressFile(filepath, contents, false); }
-            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents, const bool append);
+            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents) { compressFile(filepath, contents, CODEC_XZ, false); }
+            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents, const bool append) { compressFile(filepath, contents, CODEC_XZ, append); }
+            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents, const Codecs codec) { compressFile(filepath, contents, codec, false); }
+            static void const compressFile(const char*__restrict__ filepath, const File::FileContents& contents, const Codecs codec, const bool append);
+
+            static File::FileContents decompress(const File::FileContents& compressed) { return decompress(compressed, "buffer"); }
+            static File::FileContents compress(const File::FileContents& contents, const Codecs codec) { return compress(contents, codec, "buffer"); }
+
+            // @return The codec @p data was compressed with, or -1 if it is not recognized
+            static int codecOf(const uint8_t* data, const size_t len);
+
+            // Variables
+            // Fast codecs are stored in frames, which can be concatenated like xz streams:
+            // |====HEADER (16B)=====================================================|===BLOCKS===|==END==|
+            // | "GMCF" | version (1B) | codec (1B) | 0 (2B) | uncompressed size (8B) |   ...      | 0 (4B) |
+            // |==================================================================================|========|
+            // Each block holds up to FRAME_BLOCK_SIZE bytes of input:
+            // | uncompressed size (4B) | stored size (4B, top bit set if not compressed) | data |
+            // Sizes are big-endian. The uncompressed size in the header is UINT64_MAX if it was unknown.
+            static constexpr uint8_t FRAME_MAGIC[] = {'G', 'M', 'C', 'F'};
+            static constexpr uint8_t FRAME_VERSION = 1;
+            static constexpr size_t FRAME_HEADER_SIZE = 16;
+            static constexpr size_t FRAME_BLOCK_HEADER_SIZE = 8;
+            static constexpr size_t FRAME_BLOCK_SIZE = 256 * 1024;
+            static constexpr uint32_t FRAME_BLOCK_STORED = 1U << 31;
+            static constexpr uint8_t XZ_MAGIC[] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+
+        private:
+            // Functions
+            // @p name is only used in crash messages
+            static File::FileContents decompress(const File::FileContents& compressed, const char*__restrict__ name);
+            static File::FileContents compress(const File::FileContents& contents, const Codecs codec, const char*__restrict__ name);
+    };
+
+    // Compresses data into a file as it is written, keeping at most one block of input in memory.
+    // Output goes to a temporary file, which only replaces (or is appended to) the target on close(). A writer that
+    // is destroyed without being closed discards everything written to it.
+    class CompressionWriter {
+        public:
+            // Constructors
+            CompressionWriter(const char*__restrict__ filepath, const Compression::Codecs codec) :
+                CompressionWriter(filepath, codec, false) {}
+            CompressionWriter(const char*__restrict__ filepath, const Compression::Codecs codec, const bool append);
+            ~CompressionWriter();
+
+            CompressionWriter(const CompressionWriter &) = delete;
+            CompressionWriter &operator=(const CompressionWriter &) = delete;
+
+            // Functions
+            void write(const uint8_t*__restrict__ data, const size_t len);
+            inline void write(const File::FileContents& contents) { write(contents.get(), contents.length()); }
+            // Writes a size-prefixed BKV, read back with CompressionReader::readBKV().
+            void write(const BKV_t& bkv);
+
+            void close();
+
+        private:
+            // Functions
+            void flushBlock();
+            // @return True once the stream has ended
+            bool encode(const int action);
+
+            // Variables
+            UTF8Str _path;
+            UTF8Str _tempPath;
+            FILE* _file = nullptr;
+            Compression::Codecs _codec;
+            bool _append;
+            uint64_t _written = 0;
+
+            void* _lzma = nullptr; // lzma_stream, kept opaque so lzma.h stays out of this header
+            uint8_t* _buffer = nullptr; // Input block for LZ4, output buffer for xz
+            size_t _bufferLen = 0;
+            uint8_t* _block = nullptr; // Compressed block for LZ4
+    };
+
+    // Decompresses a file as it is read, keeping at most one block of output in memory.
+    // The file's lock is held shared for the lifetime of the reader.
+    class CompressionReader {
+        public:
+            // Constructors
+            CompressionReader(const char*__restrict__ filepath);
+            ~CompressionReader();
+
+            CompressionReader(const CompressionReader &) = delete;
+            CompressionReader &operator=(const CompressionReader &) = delete;
+
+            // Functions
+            // @return Number of bytes read, which is less than @p len only at the end of the file
+            size_t read(uint8_t*__restrict__ data, const size_t len);
+            // Reads a BKV written by CompressionWriter::write(const BKV_t&).
+            BKV_t readBKV();
+
+            bool eof() const { return _eof; }
+
+        private:
+            // Functions
+            bool readFrameHeader();
+            bool readBlock();
+            bool readExact(uint8_t*__restrict__ data, const size_t len);
+
+            // Variables
+            UTF8Str _path;
+            std::shared_lock<std::shared_mutex> _lock;
+            FILE* _file = nullptr;
+            int _codec = -1;
+            bool _eof = false;
+
+            void* _lzma = nullptr; // lzma_stream, kept opaque so lzma.h stays out of this header
+            uint8_t* _in = nullptr; // Compressed input
+            size_t _inLen = 0;
+            uint8_t* _block = nullptr; // Decompressed LZ4 block
+            size_t _blockPos = 0;
+            size_t _blockLen = 0;
     };
 }
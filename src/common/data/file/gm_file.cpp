@@ -1,10 +1,12 @@
 #include "gm_file.hpp"
 
+#include "gm_async_io.hpp"
 #include "gm_logger.hpp"
 #include "../../system/gm_system.hpp"
 #include "../../headers/string.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <bit>
 #include <cstdio>
 #include <cstdlib>
@@ -12,6 +14,8 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <system_error>
 #include <vector>
 
 #if defined(_WIN32)
@@ -32,7 +36,8 @@ namespace fs = std::filesystem;
 
 namespace game {
     UTF8Str File::_executableDir = EMPTY_STR;
-    std::mutex File::_fileMtx;
+    std::array<std::shared_mutex, File::FILE_LOCK_STRIPES> File::_fileMtxs;
+    static std::atomic<uint64_t> tempFileCounter_ = 0;
 
     void File::init() {
         findExecutableDir();
@@ -58,7 +63,7 @@ namespace game {
         uint8_t* data = static_cast<uint8_t*>(std::malloc(capacity));
 
         // Open file
-        _fileMtx.lock();
+        std::shared_lock lock(fileMutex(filepath));
         FILE* f = std::fopen(filepath, "rb");
         if (!f) {
             UTF8Str msg = FormatString::formatString("Could not open file: %s", filepath);
@@ -81,7 +86,7 @@ namespace game {
 
         // Close file
         std::fclose(f);
-        _fileMtx.unlock();
+        lock.unlock();
         data = static_cast<uint8_t*>(std::realloc(data, head));
 
         return FileContents{head, std::shared_ptr<const uint8_t>(data, std::free)};
@@ -94,13 +99,9 @@ namespace game {
         }
 
 
-        // Open file
-        _fileMtx.lock();
-        FILE* f = std::fopen(filepath, append ? "ab" : "wb");
-        if (!f) {
-            UTF8Str msg = FormatString::formatString("Could not open file: %s", filepath);
-            Logger::crash(msg);
-        }
+        // Write to a temporary file so other files (and readers of this one) are not blocked
+        UTF8Str tempPath;
+        FILE* f = openTempFile(filepath, tempPath);
 
         // Write
         const size_t len = contents.length();
@@ -111,9 +112,118 @@ namespace game {
             std::fwrite(data + head, 1, c, f);
         }
 
-        // Close file
+        // Close and commit file
         std::fclose(f);
-        _fileMtx.unlock();
+        commitTempFile(filepath, tempPath, append);
+    }
+
+    // Requests outlive the call that submits them, so they get their own copy of the caller's path
+    static UTF8Str ownedPath_(const char* filepath) {
+        const size_t len = std::strlen(filepath);
+        char* path = static_cast<char*>(std::malloc(len + 1));
+        std::memcpy(path, filepath, len + 1);
+        return UTF8Str{static_cast<int64_t>(len), std::shared_ptr<const char>(path, std::free)};
+    }
+
+    std::future<File::FileContents> File::readAsync(const char* filepath) {
+        auto promise = std::make_shared<std::promise<FileContents>>();
+        std::future<FileContents> future = promise->get_future();
+        AsyncIO::submit(AsyncIO::Request{
+            AsyncIO::ASYNC_READ,
+            ownedPath_(filepath),
+            FileContents{},
+            [promise](const FileContents& contents, std::exception_ptr error) {
+                if (error) promise->set_exception(error);
+                else promise->set_value(contents);
+            }
+        });
+        return future;
+    }
+
+    void File::readAsync(const char* filepath, std::function<void(const FileContents&)> callback) {
+        AsyncIO::submit(AsyncIO::Request{
+            AsyncIO::ASYNC_READ,
+            ownedPath_(filepath),
+            FileContents{},
+            [callback](const FileContents& contents, std::exception_ptr error) {
+                // Errors have already been reported through Logger::crash()
+                if (!error) callback(contents);
+            }
+        });
+    }
+
+    std::future<void> File::writeAsync(const char* filepath, const FileContents& contents, const bool append) {
+        auto promise = std::make_shared<std::promise<void>>();
+        std::future<void> future = promise->get_future();
+        AsyncIO::submit(AsyncIO::Request{
+            append ? AsyncIO::ASYNC_APPEND : AsyncIO::ASYNC_WRITE,
+            ownedPath_(filepath),
+            contents,
+            [promise](const FileContents&, std::exception_ptr error) {
+                if (error) promise->set_exception(error);
+                else promise->set_value();
+            }
+        });
+        return future;
+    }
+
+    std::shared_mutex& File::fileMutex(const char* filepath) {
+        // Normalize the path so different spellings of the same file share a lock
+        std::error_code err;
+        fs::path p = fs::absolute(filepath, err);
+        if (err) p = filepath;
+        const size_t hash = std::hash<std::string>{}(p.lexically_normal().string());
+        return _fileMtxs[hash % FILE_LOCK_STRIPES];
+    }
+
+    FILE* File::openTempFile(const char* filepath, UTF8Str& tempPath) {
+        tempPath = FormatString::formatString("%s.%lu.tmp", filepath, tempFileCounter_.fetch_add(1, std::memory_order_relaxed));
+        FILE* f = std::fopen(tempPath.get(), "wb");
+        if (!f) {
+            UTF8Str msg = FormatString::formatString("Could not open file: %s", tempPath.get());
+            Logger::crash(msg);
+        }
+        return f;
+    }
+
+    void File::commitTempFile(const char* filepath, const UTF8Str& tempPath, const bool append) {
+        std::unique_lock lock(fileMutex(filepath));
+        if (!append) {
+            // Rename replaces the old file in one step, so readers never see a partially written file
+            std::error_code err;
+            fs::rename(tempPath.get(), filepath, err);
+            if (err) {
+                lock.unlock();
+                fs::remove(tempPath.get(), err);
+                UTF8Str msg = FormatString::formatString("Could not write file: %s", filepath);
+                Logger::crash(msg);
+            }
+            return;
+        }
+
+        FILE* in = std::fopen(tempPath.get(), "rb");
+        FILE* out = std::fopen(filepath, "ab");
+        if (!in || !out) {
+            if (in) std::fclose(in);
+            if (out) std::fclose(out);
+            lock.unlock();
+            std::error_code err;
+            fs::remove(tempPath.get(), err);
+            UTF8Str msg = FormatString::formatString("Could not open file: %s", filepath);
+            Logger::crash(msg);
+        }
+
+        // Append
+        uint8_t buf[BUFSIZ];
+        size_t c = 0;
+        while ((c = std::fread(buf, 1, sizeof(buf), in)) > 0) std::fwrite(buf, 1, c, out);
+
+        // Close and remove temporary file
+        std::fclose(out);
+        std::fclose(in);
+        lock.unlock();
+        std::error_code err;
+        fs::remove(tempPath.get(), err);
     }
 
     void File::findExecutableDir()
@@ -2,8 +2,13 @@
 
 #include "../string/gm_utf8.hpp"
 
+#include <array>
 #include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <future>
 #include <memory>
+#include <shared_mutex>
 
 namespace game {
     class File {
@@ -38,19 +43,35 @@ namespace game {
                 writeFile(filepath, contents, false);
             }
             static void const writeFile(const char* filepath, const FileContents& contents, const bool append);
+
+            // Asynchronous versions of readFile() and writeFile(), serviced by AsyncIO.
+            // Callbacks run on an I/O thread; futures rethrow the crash exception if the request failed.
+            static std::future<FileContents> readAsync(const char* filepath);
+            static void readAsync(const char* filepath, std::function<void(const FileContents&)> callback);
+            static inline std::future<void> writeAsync(const char* filepath, const FileContents& contents) {
+                return writeAsync(filepath, contents, false);
+            }
+            static std::future<void> writeAsync(const char* filepath, const FileContents& contents, const bool append);
+
+            // Readers take the lock shared and writers take it exclusive.
+            static std::shared_mutex& fileMutex(const char* filepath);
+
+            // Opens a uniquely named temporary file next to @p filepath for writing, so writers do not need the lock
+            // until the finished file is committed with commitTempFile().
+            static FILE* openTempFile(const char* filepath, UTF8Str& tempPath);
+            // Replaces (or appends to) @p filepath with the contents of the temporary file at @p tempPath.
+            static void commitTempFile(const char* filepath, const UTF8Str& tempPath, const bool append);
             
             static UTF8Str executableDir() { return _executableDir; }
 
             // Variables
+            // Number of locks that file paths are hashed into. Different files only contend if they share a stripe.
+            static constexpr size_t FILE_LOCK_STRIPES = 64;
+
             // Level 3 seems to be a good compromise between compression size and speed.
             // Level 2-3 has a noticeable difference in size and moderate increase in compression time.
             // Level 4 has very little increase but double the time of 3.
             static constexpr uint32_t COMPRESSION_PRESET = 3;
-        
-        protected:
-            friend class Compression;
-            // Variables
-            static std::mutex _fileMtx;
             
         private:
             // Functions
@@ -58,5 +79,6 @@ namespace game {
 
             // Variables
             static UTF8Str _executableDir;
+            static std::array<std::shared_mutex, FILE_LOCK_STRIPES> _fileMtxs;
     };
 }
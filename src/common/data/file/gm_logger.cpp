@@ -3,22 +3,39 @@
 #include "gm_file.hpp"
 #include "../../gm_core.hpp"
 #include "../../headers/string.hpp"
+#include "../../system/gm_jobs.hpp"
 #include "../../system/gm_system.hpp"
 #include "../../system/gm_threads.hpp"
 
 #include <atomic>
 #include <csignal>
 #include <cstdio>
-#include <future>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <sys/time.h>
+#include <vector>
 
 namespace game {
     static std::mutex mtx_;
     static std::atomic<bool> crashed_ = false;
+
+    // Messages logged while Jobs is running are written in order by a single job at a time.
+    // Callers may pass strings they free right after logging, so entries own a copy of the message.
+    typedef struct LogEntry_ {
+        int logType;
+        int64_t length;
+        std::shared_ptr<const char> message;
+        const UTF8Str* threadName; // Registry names live for the whole run
+        struct timeval time;
+    } LogEntry;
+    static std::mutex queueMtx_;
+    static std::vector<LogEntry> queue_;
+    static bool draining_ = false;
     UTF8Str Logger::_logPath = UTF8Str{sizeof("latest.log") - 1, std::shared_ptr<const char>("latest.log", [](const char*){})};
     UTF8Str Logger::_crashPath = UTF8Str{sizeof("crash.log") - 1, std::shared_ptr<const char>("crash.log", [](const char*){})};
     void signalHandler(int signum);
@@ -89,13 +106,57 @@ namespace game {
     }
 
     void Logger::log(const int logType, const UTF8Str& message) {
-        auto task = std::async(std::launch::async, logSync_, logType, message, std::this_thread::get_id());
+        if (!Jobs::running()) {
+            logSync_(logType, message, std::this_thread::get_id());
+            return;
+        }
+
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+
+        char* copy = static_cast<char*>(std::malloc(message.length() + 1));
+        std::memcpy(copy, message.get(), message.length());
+        copy[message.length()] = '\0';
+        std::shared_ptr<const char> owned(copy, std::free);
+
+        bool submit;
+        {
+            std::lock_guard lock(queueMtx_);
+            queue_.push_back(LogEntry{logType, message.length(), std::move(owned), &Threads::threadName(), tv});
+            submit = !draining_;
+            draining_ = true;
+        }
+        if (submit) Jobs::submit(drainLog_);
+    }
+
+    void Logger::drainLog_() {
+        while (true) {
+            std::vector<LogEntry> entries;
+            {
+                std::lock_guard lock(queueMtx_);
+                if (queue_.empty()) {
+                    draining_ = false;
+                    return;
+                }
+                entries.swap(queue_);
+            }
+
+            for (const LogEntry& entry : entries) {
+                writeLog_(entry.logType, UTF8Str{entry.length, entry.message}, *entry.threadName, entry.time);
+            }
+        }
     }
 
     void Logger::logSync_(const int logType, const UTF8Str& message, const std::thread::id& threadId) {
-        // Get time
         struct timeval tv;
         gettimeofday(&tv, nullptr);
+        writeLog_(logType, message, Threads::threadName(threadId), tv);
+    }
+
+    void Logger::writeLog_(const int logType, const UTF8Str& message, const UTF8Str& threadName,
+        const struct timeval& tv
+    ) {
+        // Get time
         time_t time = static_cast<time_t>(tv.tv_sec);
         std::tm* now = std::localtime(&time);
 
@@ -103,7 +164,7 @@ namespace game {
         // [HH::MM:SS+UUU] [THREAD/TYPE]: MESSAGE
         UTF8Str msg = FormatString::formatString("[%02d:%02d:%02d+%06u] [%s/%s]: %s\n",
             now->tm_hour, now->tm_min, now->tm_sec, tv.tv_usec, // Time
-            Threads::threadName(threadId).get(), LOG_TYPE_STRINGS[logType], // Thread
+            threadName.get(), LOG_TYPE_STRINGS[logType], // Thread
             message.get()
         );
         
@@ -150,7 +211,7 @@ namespace game {
                 System::CPU().get(),
                 System::cpuThreadCount(),
                 System::GPU().get(),
-                Threads::threadName(std::this_thread::get_id()).get()
+                Threads::threadName().get()
             );
             std::perror(msg.get());
 
@@ -4,6 +4,7 @@
 
 #include <cstring>
 #include <thread>
+#include <sys/time.h>
 
 namespace game {
     enum LOG_TYPES {
@@ -47,6 +48,9 @@ namespace game {
         private:
             // Functions
             static void logSync_(const int logType, const UTF8Str& message, const std::thread::id& threadId);
+            static void writeLog_(const int logType, const UTF8Str& message, const UTF8Str& threadName,
+                const struct timeval& time);
+            static void drainLog_();
             
             // Variables
             static UTF8Str _logPath;
@@ -0,0 +1,149 @@
+#include "gm_lz4.hpp"
+
+#include <cstring>
+
+namespace game {
+    static inline uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static inline uint32_t hashSequence(const uint32_t sequence) {
+        return (sequence * 2654435761U) >> (32 - LZ4::HASH_LOG);
+    }
+
+    static inline uint8_t* writeLength(uint8_t* op, size_t len) {
+        for (; len >= 255; len -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(len);
+        return op;
+    }
+
+    size_t LZ4::compress(const uint8_t*__restrict__ src, const size_t len, uint8_t*__restrict__ dst) noexcept {
+        uint8_t* op = dst;
+        size_t anchor = 0;
+
+        if (len > MF_LIMIT) {
+            uint32_t table[1 << HASH_LOG] = {};
+            const size_t matchLimit = len - LAST_LITERALS;
+            const size_t mfLimit = len - MF_LIMIT;
+            size_t ip = 1;
+            uint32_t misses = 0;
+
+            while (ip <= mfLimit) {
+                const uint32_t sequence = read32(src + ip);
+                const uint32_t hash = hashSequence(sequence);
+                size_t ref = table[hash];
+                table[hash] = static_cast<uint32_t>(ip);
+
+                if (ref >= ip || ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+                    // Skip faster through data that does not compress
+                    ip += 1 + (misses++ >> 6);
+                    continue;
+                }
+                misses = 0;
+
+                // Extend the match backwards over literals
+                while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                    ip--;
+                    ref--;
+                }
+
+                // Extend the match forwards
+                size_t end = ip + MIN_MATCH;
+                size_t refEnd = ref + MIN_MATCH;
+                while (end < matchLimit && src[end] == src[refEnd]) {
+                    end++;
+                    refEnd++;
+                }
+
+                // Write the sequence: token, literals, offset, match length
+                const size_t literals = ip - anchor;
+                const size_t matchLen = end - ip - MIN_MATCH;
+                uint8_t* token = op++;
+                *token = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4);
+                if (literals >= 15) op = writeLength(op, literals - 15);
+                std::memcpy(op, src + anchor, literals);
+                op += literals;
+
+                const size_t offset = ip - ref;
+                *op++ = static_cast<uint8_t>(offset);
+                *op++ = static_cast<uint8_t>(offset >> 8);
+
+                *token |= static_cast<uint8_t>(matchLen < 15 ? matchLen : 15);
+                if (matchLen >= 15) op = writeLength(op, matchLen - 15);
+
+                ip = end;
+                anchor = ip;
+                if (ip <= mfLimit) table[hashSequence(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+            }
+        }
+
+        // Last literals
+        const size_t literals = len - anchor;
+        *op++ = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4);
+        if (literals >= 15) op = writeLength(op, literals - 15);
+        std::memcpy(op, src + anchor, literals);
+        op += literals;
+
+        return static_cast<size_t>(op - dst);
+    }
+
+    int64_t LZ4::decompress(const uint8_t*__restrict__ src, const size_t len,
+        uint8_t*__restrict__ dst, const size_t capacity
+    ) noexcept {
+        size_t ip = 0, op = 0;
+
+        while (ip < len) {
+            const uint8_t token = src[ip++];
+
+            // Literals
+            size_t literals = token >> 4;
+            if (literals == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= len) return -1;
+                    b = src[ip++];
+                    literals += b;
+                } while (b == 255);
+            }
+            if (literals > len - ip || literals > capacity - op) return -1;
+            std::memcpy(dst + op, src + ip, literals);
+            ip += literals;
+            op += literals;
+
+            // The block ends with literals
+            if (ip == len) break;
+
+            // Match
+            if (len - ip < 2) return -1;
+            const size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) return -1;
+
+            size_t matchLen = token & 15;
+            if (matchLen == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= len) return -1;
+                    b = src[ip++];
+                    matchLen += b;
+                } while (b == 255);
+            }
+            matchLen += MIN_MATCH;
+            if (matchLen > capacity - op) return -1;
+
+            // Matches may overlap their own output, which repeats the pattern
+            uint8_t* out = dst + op;
+            const uint8_t* ref = out - offset;
+            if (offset >= matchLen) {
+                std::memcpy(out, ref, matchLen);
+            } else {
+                for (size_t i = 0; i < matchLen; i++) out[i] = ref[i];
+            }
+            op += matchLen;
+        }
+
+        return static_cast<int64_t>(op);
+    }
+}
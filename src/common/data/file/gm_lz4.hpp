@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace game {
+    // Fast LZ77 compressor producing the LZ4 block format, so blocks can also be read by the reference LZ4 library.
+    // Blocks are raw and carry no sizes; Compression wraps them in its own frame format.
+    class LZ4 {
+        public:
+            // Functions
+            // Maximum compressed size of @p len bytes of input.
+            static inline size_t compressBound(const size_t len) { return len + len / 255 + 16; }
+
+            // Compresses @p len bytes of @p src into @p dst, which must hold at least compressBound(len) bytes.
+            // @return Number of bytes written to @p dst
+            static size_t compress(const uint8_t*__restrict__ src, const size_t len, uint8_t*__restrict__ dst) noexcept;
+
+            // Decompresses a block of @p len bytes into @p dst, which can hold @p capacity bytes.
+            // @return Number of bytes written to @p dst, or -1 if the block is malformed or does not fit
+            static int64_t decompress(const uint8_t*__restrict__ src, const size_t len,
+                uint8_t*__restrict__ dst, const size_t capacity) noexcept;
+
+            // Variables
+            static constexpr size_t MIN_MATCH = 4;
+            static constexpr size_t MAX_OFFSET = UINT16_MAX;
+            static constexpr size_t LAST_LITERALS = 5; // The last bytes of a block are always literals
+            static constexpr size_t MF_LIMIT = 12; // A match cannot start in the last bytes of a block
+            static constexpr uint32_t HASH_LOG = 12;
+    };
+}
@@ -2,6 +2,8 @@
 
 #include "headers/file.hpp"
 #include "headers/string.hpp"
+#include "system/gm_jobs.hpp"
+#include "system/gm_profiler.hpp"
 #include "system/gm_system.hpp"
 #include "system/gm_threads.hpp"
 
@@ -14,10 +16,9 @@ namespace game {
     std::atomic<bool> Core::running = false;
 
     void Core::init(const char*__restrict__ logFile, const char*__restrict__ crashFile) {
-        Threads::registerThread(std::this_thread::get_id(),
-            UTF8Str{sizeof("Main") - 1, std::shared_ptr<const char>("Main", [](const char*){})}
-        );
+        Threads::registerThread("Main", THREAD_MAIN);
         std::srand(std::time(0));
+        Profiler::init();
 
         System::init();
         File::init();
@@ -25,6 +26,7 @@ namespace game {
             UTF8Str{static_cast<int64_t>(std::strlen(logFile)), std::shared_ptr<const char>(logFile, [](const char*){})},
             UTF8Str{static_cast<int64_t>(std::strlen(crashFile)), std::shared_ptr<const char>(crashFile, [](const char*){})}
         );
+        Jobs::init();
 
         UTF8Str msg = FormatString::formatString(
             "Hardware details:\n"
@@ -39,5 +41,15 @@ namespace game {
             System::OS().get()
         );
         Logger::log(LOG_INFO, msg.get());
+
+        AsyncIO::init();
+    }
+
+    void Core::shutdown() {
+        // Finish outstanding jobs, which may still queue file I/O
+        Jobs::shutdown();
+
+        // Finish outstanding file I/O
+        AsyncIO::shutdown();
     }
 }
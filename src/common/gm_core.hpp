@@ -10,6 +10,7 @@ namespace game {
         public:
             // Functions
             static void init(const char*__restrict__ logFile, const char*__restrict__ crashFile);
+            static void shutdown();
 
             // Variables
             static UTF8Str TITLE;
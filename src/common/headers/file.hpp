@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../data/file/gm_async_io.hpp"
 #include "../data/file/gm_compression.hpp"
 #include "../data/file/gm_file.hpp"
 #include "../data/file/gm_logger.hpp"
@@ -0,0 +1,231 @@
+#include "gm_jobs.hpp"
+
+#include "gm_system.hpp"
+#include "gm_threads.hpp"
+#include "../headers/string.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+
+namespace game {
+    std::vector<std::thread> Jobs::_threads;
+    std::atomic<bool> Jobs::_running = false;
+
+    typedef struct JobQueue_ {
+        std::mutex mtx;
+        std::deque<JobHandle> jobs;
+    } JobQueue;
+
+    // One queue per worker, then a last one shared by threads that are not workers. Made by the first init() and
+    // kept for the whole process, since threads that are not workers may still be running jobs from them in wait()
+    // while Jobs shuts down.
+    static std::vector<std::unique_ptr<JobQueue>> queues_;
+    static thread_local int32_t workerIndex_ = -1;
+
+    // Jobs queued but not yet started, and workers asleep waiting for them
+    static std::atomic<int32_t> queued_ = 0;
+    static std::atomic<uint32_t> sleeping_ = 0;
+    static std::mutex sleepMtx_;
+    static std::condition_variable sleepCv_;
+
+    void Jobs::init() {
+        if (_running) return;
+
+        // The main thread helps while it waits, so leave it a core
+        const uint32_t threadCount = std::max(System::cpuThreadCount(), static_cast<uint32_t>(2)) - 1;
+        if (queues_.empty()) {
+            for (uint32_t i = 0; i <= threadCount; i++) queues_.push_back(std::make_unique<JobQueue>());
+        }
+
+        _running = true;
+        for (uint32_t i = 0; i < threadCount; i++) {
+            _threads.emplace_back(workerLoop, i);
+        }
+    }
+
+    void Jobs::shutdown() {
+        if (!_running) return;
+
+        // Workers finish every queued job before exiting
+        {
+            std::lock_guard lock(sleepMtx_);
+            _running = false;
+        }
+        sleepCv_.notify_all();
+
+        for (std::thread& thread : _threads) thread.join();
+        _threads.clear();
+    }
+
+    int32_t Jobs::workerIndex() {
+        return workerIndex_;
+    }
+
+    JobHandle Jobs::submit(std::function<void()>&& task, const std::vector<JobHandle>& dependencies) {
+        JobHandle job = std::make_shared<Job>();
+        job->_task = std::move(task);
+
+        if (!running()) {
+            // Not started (or already stopped), so dependencies have already run on this thread
+            run(job);
+            return job;
+        }
+
+        for (const JobHandle& dependency : dependencies) {
+            std::lock_guard lock(dependency->_mtx);
+            if (dependency->_finished) continue;
+            job->_waitingOn.fetch_add(1, std::memory_order_relaxed);
+            dependency->_continuations.push_back(job);
+        }
+
+        // Drop the submission reference, and schedule now if nothing is left to wait on
+        if (job->_waitingOn.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(job);
+        return job;
+    }
+
+    void Jobs::schedule(const JobHandle& job) {
+        if (!running() && workerIndex_ < 0) {
+            // Finished by a worker after shutdown began, which drains the queues before exiting
+            run(job);
+            return;
+        }
+
+        JobQueue& queue = *queues_[workerIndex_ >= 0 ? workerIndex_ : queues_.size() - 1];
+        {
+            std::lock_guard lock(queue.mtx);
+            queue.jobs.push_back(job);
+        }
+        queued_++;
+
+        if (sleeping_) {
+            std::lock_guard lock(sleepMtx_);
+            sleepCv_.notify_one();
+        }
+    }
+
+    bool Jobs::runOne() {
+        JobHandle job;
+        const size_t queueCount = queues_.size();
+        const size_t self = workerIndex_ >= 0 ? workerIndex_ : queueCount - 1;
+
+        // Newest job from this thread's own queue, which is most likely to still be in cache
+        {
+            JobQueue& queue = *queues_[self];
+            std::lock_guard lock(queue.mtx);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            }
+        }
+
+        // Otherwise steal the oldest job from another queue
+        for (size_t i = 1; !job && i < queueCount; i++) {
+            JobQueue& queue = *queues_[(self + i) % queueCount];
+            std::lock_guard lock(queue.mtx);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+        }
+
+        if (!job) return false;
+        queued_--;
+        run(job);
+        return true;
+    }
+
+    void Jobs::run(const JobHandle& job) {
+        try {
+            job->_task();
+        } catch (...) {
+            job->_error = std::current_exception();
+        }
+        job->_task = nullptr;
+
+        std::vector<JobHandle> continuations;
+        {
+            std::lock_guard lock(job->_mtx);
+            job->_finished = true;
+            continuations.swap(job->_continuations);
+            job->_done.store(true, std::memory_order_release);
+        }
+
+        for (const JobHandle& continuation : continuations) {
+            if (continuation->_waitingOn.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(continuation);
+        }
+    }
+
+    void Jobs::wait(const JobHandle& job) {
+        while (!job->done()) {
+            if (!queues_.empty() && runOne()) continue;
+            std::this_thread::yield();
+        }
+
+        if (job->_error) std::rethrow_exception(job->_error);
+    }
+
+    void Jobs::parallelFor(const size_t count, const size_t grain,
+        const std::function<void(const size_t begin, const size_t end)>& task
+    ) {
+        const size_t step = std::max(grain, static_cast<size_t>(1));
+        const size_t ranges = (count + step - 1) / step;
+        if (ranges == 0) return;
+        if (ranges == 1 || !running()) {
+            for (size_t begin = 0; begin < count; begin += step) task(begin, std::min(begin + step, count));
+            return;
+        }
+
+        // Every thread takes the next range until none are left, which balances uneven ranges. A thread that throws
+        // takes the rest, so the others stop early.
+        std::atomic<size_t> next = 0;
+        auto loop = [&] {
+            try {
+                for (size_t begin; (begin = next.fetch_add(step, std::memory_order_relaxed)) < count;) {
+                    task(begin, std::min(begin + step, count));
+                }
+            } catch (...) {
+                next.store(count, std::memory_order_relaxed);
+                throw;
+            }
+        };
+
+        std::vector<JobHandle> helpers;
+        const size_t helperCount = std::min(ranges - 1, static_cast<size_t>(workerCount()));
+        for (size_t i = 0; i < helperCount; i++) helpers.push_back(submit(loop));
+
+        std::exception_ptr error;
+        try {
+            loop();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // Every helper uses this frame, so all of them finish before anything is rethrown
+        for (const JobHandle& helper : helpers) {
+            while (!helper->done()) {
+                if (!queues_.empty() && runOne()) continue;
+                std::this_thread::yield();
+            }
+            if (!error) error = helper->_error;
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void Jobs::workerLoop(const uint32_t index) {
+        workerIndex_ = static_cast<int32_t>(index);
+        Threads::registerThread("Worker", THREAD_WORKER);
+
+        while (true) {
+            if (runOne()) continue;
+
+            std::unique_lock lock(sleepMtx_);
+            sleeping_++;
+            sleepCv_.wait(lock, [] { return queued_ > 0 || !_running; });
+            sleeping_--;
+            if (!_running && queued_ <= 0) break;
+        }
+
+        Threads::removeThread();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace game {
+    class Jobs;
+
+    // A job submitted to Jobs, which can be waited on or used as a dependency of later jobs.
+    class Job {
+        public:
+            // Functions
+            bool done() const { return _done.load(std::memory_order_acquire); }
+
+        private:
+            friend class Jobs;
+
+            // Variables
+            std::function<void()> _task;
+            std::atomic<uint32_t> _waitingOn = 1; // Unfinished dependencies, plus one while being submitted
+            std::atomic<bool> _done = false;
+            std::exception_ptr _error;
+
+            std::mutex _mtx;
+            bool _finished = false;
+            std::vector<std::shared_ptr<Job>> _continuations; // Jobs waiting on this one
+    };
+    typedef std::shared_ptr<Job> JobHandle;
+
+    // Work-stealing thread pool that lives from Core::init() to Core::shutdown().
+    // Each worker pushes and pops its own jobs from the back of its queue, and steals from the front of the others
+    // when it runs out. Threads that wait on a job run other jobs in the meantime, so jobs may wait on jobs.
+    class Jobs {
+        public:
+            // Functions
+            static void init();
+            static void shutdown();
+
+            // Runs @p task on a worker. If Jobs is not running, @p task runs before this returns.
+            static JobHandle submit(std::function<void()>&& task) { return submit(std::move(task), {}); }
+            // Runs @p task once every job in @p dependencies is done.
+            static JobHandle submit(std::function<void()>&& task, const std::vector<JobHandle>& dependencies);
+
+            // Runs other jobs until @p job is done, then rethrows anything it threw.
+            static void wait(const JobHandle& job);
+            static void wait(const std::vector<JobHandle>& jobs) { for (const JobHandle& job : jobs) wait(job); }
+
+            // Calls @p task over [0, @p count) in ranges of at most @p grain, spread over the workers and this thread.
+            static void parallelFor(const size_t count, const size_t grain,
+                const std::function<void(const size_t begin, const size_t end)>& task);
+
+            static bool running() { return _running.load(std::memory_order_acquire); }
+            static uint32_t workerCount() { return static_cast<uint32_t>(_threads.size()); }
+            // @return The calling thread's worker index, or -1 if it is not a worker
+            static int32_t workerIndex();
+
+        private:
+            // Functions
+            static void workerLoop(const uint32_t index);
+            static void schedule(const JobHandle& job);
+            static bool runOne();
+            static void run(const JobHandle& job);
+
+            // Variables
+            static std::vector<std::thread> _threads;
+            static std::atomic<bool> _running;
+    };
+}
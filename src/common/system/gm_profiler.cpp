@@ -0,0 +1,163 @@
+#include "gm_profiler.hpp"
+
+#include "gm_threads.hpp"
+#include "../headers/file.hpp"
+#include "../headers/string.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace game {
+    std::atomic<bool> Profiler::_enabled = true;
+
+    typedef struct ThreadProfile_ {
+        const UTF8Str* name; // Registry names live for the whole run
+        uint32_t id; // Small number for traces, in order of first zone
+        std::atomic<uint64_t> written = 0; // Events ever written, the newest at (written - 1) % BUFFER_EVENTS
+        std::array<ProfileEvent, Profiler::BUFFER_EVENTS> events;
+    } ThreadProfile;
+
+    // Buffers outlive their threads, so zones from finished threads still show up
+    static std::vector<std::unique_ptr<ThreadProfile>> profiles_;
+    static std::mutex profilesMtx_;
+    static thread_local ThreadProfile* profile_ = nullptr;
+
+    // Reference points for converting timestamps to time
+    static uint64_t startTimestamp_ = Profiler::timestamp();
+    static std::chrono::steady_clock::time_point startTime_ = std::chrono::steady_clock::now();
+
+    void Profiler::init() {
+        startTimestamp_ = timestamp();
+        startTime_ = std::chrono::steady_clock::now();
+    }
+
+    float64_t Profiler::milliseconds(const uint64_t ticks) {
+        // The counter rate is measured against the steady clock over the whole run, which gets more precise over time
+        const float64_t elapsedMs = std::chrono::duration<float64_t, std::milli>(std::chrono::steady_clock::now() - startTime_).count();
+        const uint64_t elapsedTicks = timestamp() - startTimestamp_;
+        if (elapsedTicks == 0) return 0.;
+        return ticks * (elapsedMs / elapsedTicks);
+    }
+
+    void Profiler::record(const char*__restrict__ name, const uint64_t start, const uint64_t end) {
+        if (!profile_) {
+            std::unique_ptr<ThreadProfile> profile = std::make_unique<ThreadProfile>();
+            profile->name = &Threads::threadName();
+            if (ThreadInfo* info = Threads::current()) info->profile.store(profile.get(), std::memory_order_relaxed);
+
+            std::lock_guard lock(profilesMtx_);
+            profile->id = static_cast<uint32_t>(profiles_.size());
+            profile_ = profile.get();
+            profiles_.push_back(std::move(profile));
+        }
+
+        // Only this thread writes its buffer, so publishing the count is enough for readers
+        const uint64_t written = profile_->written.load(std::memory_order_relaxed);
+        profile_->events[written % BUFFER_EVENTS] = ProfileEvent{name, start, end};
+        profile_->written.store(written + 1, std::memory_order_release);
+    }
+
+    // Calls @p fn(profile, event) for every buffered event, oldest first per thread.
+    template<typename F>
+    static void forEachEvent_(F&& fn) {
+        std::lock_guard lock(profilesMtx_);
+        for (const std::unique_ptr<ThreadProfile>& profile : profiles_) {
+            const uint64_t written = profile->written.load(std::memory_order_acquire);
+            const uint64_t first = written > Profiler::BUFFER_EVENTS ? written - Profiler::BUFFER_EVENTS : 0;
+            for (uint64_t i = first; i < written; i++) fn(*profile, profile->events[i % Profiler::BUFFER_EVENTS]);
+        }
+    }
+
+    std::vector<ProfileStats> Profiler::stats() {
+        std::unordered_map<const char*, std::vector<uint64_t>> durations;
+        forEachEvent_([&](const ThreadProfile&, const ProfileEvent& event) {
+            durations[event.name].push_back(event.end - event.start);
+        });
+
+        std::vector<ProfileStats> stats;
+        for (auto& [name, ticks] : durations) {
+            const size_t p50 = ticks.size() / 2;
+            const size_t p99 = ticks.size() * 99 / 100;
+            std::nth_element(ticks.begin(), ticks.begin() + p50, ticks.end());
+            const uint64_t p50Ticks = ticks[p50];
+            std::nth_element(ticks.begin(), ticks.begin() + p99, ticks.end());
+            const uint64_t p99Ticks = ticks[p99];
+            const uint64_t maxTicks = *std::max_element(ticks.begin() + p99, ticks.end());
+
+            stats.push_back(ProfileStats{name, ticks.size(), milliseconds(p50Ticks), milliseconds(p99Ticks), milliseconds(maxTicks)});
+        }
+
+        std::sort(stats.begin(), stats.end(), [](const ProfileStats& a, const ProfileStats& b) { return a.p99 > b.p99; });
+        return stats;
+    }
+
+    void Profiler::logStats() {
+        for (const ProfileStats& zone : stats()) {
+            UTF8Str msg = FormatString::formatString("Profile %s: %lu samples, p50 %.3fms, p99 %.3fms, max %.3fms",
+                zone.name, zone.count, zone.p50, zone.p99, zone.max
+            );
+            Logger::log(LOG_INFO, msg);
+        }
+    }
+
+    // Writes @p str as a quoted JSON string, escaping what JSON does not allow inside one.
+    static void writeJsonString_(FILE* file, const char*__restrict__ str) {
+        std::fputc('"', file);
+        for (; *str; str++) {
+            const unsigned char c = static_cast<unsigned char>(*str);
+            if (c == '"' || c == '\\') {
+                std::fputc('\\', file);
+                std::fputc(c, file);
+            } else if (c < 0x20) {
+                std::fprintf(file, "\\u%04x", c);
+            } else {
+                std::fputc(c, file);
+            }
+        }
+        std::fputc('"', file);
+    }
+
+    void Profiler::exportTrace(const char*__restrict__ filepath) {
+        // Relative to the executable like the log files, so it lands in the same place wherever the game is run from
+        const UTF8Str path = FormatString::formatString("%s%s", File::executableDir().get(), filepath);
+        File::ensureParentDir(path);
+
+        UTF8Str tempPath;
+        FILE* file = File::openTempFile(path.get(), tempPath);
+
+        // Timestamps in microseconds since init()
+        const float64_t usPerTick = milliseconds(1 << 20) * 1000. / (1 << 20);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        bool first = true;
+        {
+            std::lock_guard lock(profilesMtx_);
+            for (const std::unique_ptr<ThreadProfile>& profile : profiles_) {
+                std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",", profile->id
+                );
+                writeJsonString_(file, profile->name->get());
+                std::fputs("}}", file);
+                first = false;
+            }
+        }
+        forEachEvent_([&](const ThreadProfile& profile, const ProfileEvent& event) {
+            if (event.start < startTimestamp_) return; // Recorded before init()
+            std::fputs(",\n{\"name\":", file);
+            writeJsonString_(file, event.name);
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                profile.id, (event.start - startTimestamp_) * usPerTick, (event.end - event.start) * usPerTick
+            );
+        });
+        std::fputs("\n]}\n", file);
+
+        if (std::fclose(file)) {
+            UTF8Str msg = FormatString::formatString("Could not write file: %s", tempPath.get());
+            Logger::crash(msg);
+        }
+        File::commitTempFile(path.get(), tempPath, false);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../headers/float.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace game {
+    typedef struct ProfileEvent_ {
+        const char* name;
+        uint64_t start; // Profiler::timestamp() values
+        uint64_t end;
+    } ProfileEvent;
+
+    // Durations in milliseconds over the events still buffered for one zone name
+    typedef struct ProfileStats_ {
+        const char* name;
+        size_t count;
+        float64_t p50;
+        float64_t p99;
+        float64_t max;
+    } ProfileStats;
+
+    // Records how long named zones of code take, cheaply enough to leave on in release builds.
+    // Each thread appends finished zones to its own ring buffer without locking, keeping the latest BUFFER_EVENTS, so
+    // stats and traces always cover the most recent activity. Reading the buffers while zones are being recorded may
+    // see a few torn events from threads that wrapped around during the read.
+    class Profiler {
+        public:
+            // Functions
+            static void init();
+
+            static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+            static void setEnabled(const bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+            // @return The CPU's timestamp counter, or nanoseconds on targets without one
+            static uint64_t timestamp() {
+            #if defined(__x86_64__) || defined(__i386__)
+                return __rdtsc();
+            #else
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            #endif
+            }
+            // Converts a difference of timestamp() values to milliseconds.
+            static float64_t milliseconds(const uint64_t ticks);
+
+            // @p name must be a string literal, zones are grouped by its address.
+            static void record(const char*__restrict__ name, const uint64_t start, const uint64_t end);
+
+            // @return Stats per zone name, slowest p99 first
+            static std::vector<ProfileStats> stats();
+            static void logStats();
+            // Writes every buffered zone as Chrome trace events, for chrome://tracing or Perfetto.
+            // @p filepath is relative to the executable's directory, like the paths given to Core::init().
+            static void exportTrace(const char*__restrict__ filepath);
+
+            // Variables
+            static constexpr size_t BUFFER_EVENTS = 16 * 1024; // Per thread
+
+        private:
+            // Variables
+            static std::atomic<bool> _enabled;
+    };
+
+    // Records the time from its construction to its destruction as a zone, if the profiler was enabled when it began.
+    class ProfileZone {
+        public:
+            // Constructors
+            ProfileZone(const char*__restrict__ name) : _name{name}, _start{Profiler::enabled() ? Profiler::timestamp() : 0} {}
+            ~ProfileZone() { if (_start) Profiler::record(_name, _start, Profiler::timestamp()); }
+
+            ProfileZone(const ProfileZone &) = delete;
+            ProfileZone &operator=(const ProfileZone &) = delete;
+
+        private:
+            // Variables
+            const char* _name;
+            uint64_t _start;
+    };
+}
+
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_VAR_(line) PROFILE_ZONE_CONCAT_(profileZone_, line)
+// Profiles the rest of the enclosing scope as @p name, which must be a string literal.
+#define PROFILE_ZONE(name) game::ProfileZone PROFILE_ZONE_VAR_(__LINE__){name}
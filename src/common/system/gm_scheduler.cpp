@@ -0,0 +1,65 @@
+#include "gm_scheduler.hpp"
+
+#include "gm_profiler.hpp"
+
+#include <exception>
+
+namespace game {
+    void Scheduler::add(const char*__restrict__ name, const AccessMask reads, const AccessMask writes,
+        std::function<void()>&& system
+    ) {
+        System added{name, reads, writes, std::move(system), {}};
+
+        // Depend on the latest earlier system touching each conflicting resource. Anything before that is already
+        // waited on through it, so only walk back until every conflict is covered.
+        AccessMask uncoveredReads = reads | writes; // Resources still needing a preceding writer
+        AccessMask uncoveredWrites = writes; // Resources still needing preceding readers
+        for (size_t i = _systems.size(); i-- > 0 && (uncoveredReads || uncoveredWrites);) {
+            const System& earlier = _systems[i];
+            const bool conflicts = (earlier.writes & uncoveredReads) || (earlier.reads & uncoveredWrites);
+            if (!conflicts) continue;
+
+            added.dependencies.push_back(static_cast<uint32_t>(i));
+            // A writer orders everything before it that touched the same resources
+            uncoveredReads &= ~earlier.writes;
+            uncoveredWrites &= ~earlier.writes;
+        }
+
+        _systems.push_back(std::move(added));
+    }
+
+    void Scheduler::run() {
+        if (!Jobs::running()) {
+            // Adding order already satisfies every dependency
+            for (System& system : _systems) {
+                ProfileZone zone{system.name};
+                system.run();
+            }
+            return;
+        }
+
+        _jobs.clear();
+        for (System& system : _systems) {
+            std::vector<JobHandle> dependencies;
+            dependencies.reserve(system.dependencies.size());
+            for (const uint32_t dependency : system.dependencies) dependencies.push_back(_jobs[dependency]);
+
+            _jobs.push_back(Jobs::submit([&system] {
+                ProfileZone zone{system.name};
+                system.run();
+            }, dependencies));
+        }
+
+        // Let every system finish before rethrowing, since later systems still reference this scheduler
+        std::exception_ptr error;
+        for (const JobHandle& job : _jobs) {
+            try {
+                Jobs::wait(job);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        _jobs.clear();
+        if (error) std::rethrow_exception(error);
+    }
+}
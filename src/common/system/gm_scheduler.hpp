@@ -0,0 +1,50 @@
+#pragma once
+
+#include "gm_jobs.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace game {
+    typedef uint64_t AccessMask; // One bit per resource a system touches, such as a component type
+
+    // Runs a fixed set of systems once per tick on Jobs.
+    // Each system declares the resources it reads and writes. Two systems conflict if either writes something the other
+    // reads or writes, and conflicting systems always run in the order they were added, while the rest run in parallel.
+    // The order of conflicting systems never depends on thread timing, so a tick gives the same result every run.
+    class Scheduler {
+        public:
+            // Functions
+            // Adds a system that runs after every earlier system it conflicts with.
+            // @p name must be a string literal, each run of the system is profiled under it.
+            void add(const char*__restrict__ name, const AccessMask reads, const AccessMask writes,
+                std::function<void()>&& system);
+
+            // Runs every system once, then returns when they are all done. Rethrows the first exception a system threw.
+            void run();
+
+            size_t size() const { return _systems.size(); }
+            const char* name(const size_t system) const { return _systems[system].name; }
+            // @return The indices of the systems that @p system waits on
+            const std::vector<uint32_t>& dependencies(const size_t system) const { return _systems[system].dependencies; }
+
+            // Variables
+            static constexpr AccessMask ALL = UINT64_MAX; // For systems that must run alone, like structural changes
+
+        private:
+            // Types
+            typedef struct System_ {
+                const char* name;
+                AccessMask reads;
+                AccessMask writes;
+                std::function<void()> run;
+                std::vector<uint32_t> dependencies;
+            } System;
+
+            // Variables
+            std::vector<System> _systems;
+            std::vector<JobHandle> _jobs;
+    };
+}
@@ -1,5 +1,101 @@
 #include "gm_threads.hpp"
 
+#if defined(_WIN32)
+  #include <windows.h>
+#elif defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include <cstring>
+#include <deque>
+
 namespace game {
-    std::unordered_map<std::thread::id, UTF8Str> Threads::_threads;
+    std::array<ThreadInfo, Threads::MAX_THREADS> Threads::_threads;
+    std::mutex Threads::_threadsMtx;
+    uint32_t Threads::_used = 0;
+
+    static thread_local ThreadInfo* current_ = nullptr;
+    static const UTF8Str asyncName_ = UTF8Str{sizeof("Async") - 1, std::shared_ptr<const char>("Async", [](const char*){})};
+    static ThreadInfo overflow_{&asyncName_}; // Shared by every thread registered while the table is full
+    // Every distinct name ever registered. Names are never freed, as log entries and profiles keep pointers to them,
+    // and threads started over and over under the same name share one copy.
+    static std::deque<UTF8Str> names_;
+
+    // Must be called with the registry locked.
+    static const UTF8Str* internName_(const UTF8Str& name) {
+        for (const UTF8Str& known : names_) {
+            if (known.length() == name.length() && std::memcmp(known.get(), name.get(), name.length()) == 0) return &known;
+        }
+        return &names_.emplace_back(name);
+    }
+
+    ThreadInfo& Threads::registerThread(const UTF8Str& name, const int32_t role) {
+        if (current_) return *current_;
+
+        std::lock_guard lock(_threadsMtx);
+        uint32_t index = 0;
+        while (index < _used && _threads[index].alive.load(std::memory_order_relaxed)) index++;
+        if (index >= MAX_THREADS) {
+            current_ = &overflow_;
+            return overflow_;
+        }
+        if (index == _used) _used++;
+
+        ThreadInfo& info = _threads[index];
+        info.name = internName_(name);
+        info.id = std::this_thread::get_id();
+        info.role = role;
+        info.cpu.store(-1, std::memory_order_relaxed);
+        info.profile.store(nullptr, std::memory_order_relaxed);
+        info.alive.store(true, std::memory_order_relaxed);
+
+        current_ = &info;
+        return info;
+    }
+
+    void Threads::removeThread() {
+        if (!current_) return;
+        if (current_ != &overflow_) {
+            std::lock_guard lock(_threadsMtx);
+            current_->alive.store(false, std::memory_order_relaxed);
+        }
+        current_ = nullptr;
+    }
+
+    ThreadInfo* Threads::current() {
+        return current_;
+    }
+
+    const UTF8Str& Threads::threadName() {
+        return current_ ? *current_->name : asyncName_;
+    }
+
+    const UTF8Str& Threads::threadName(const std::thread::id& id) {
+        if (current_ && current_->id == id) return *current_->name;
+
+        // Thread ids can be reused once a thread exits, so only live entries count
+        std::lock_guard lock(_threadsMtx);
+        for (uint32_t i = 0; i < _used; i++) {
+            const ThreadInfo& info = _threads[i];
+            if (info.alive.load(std::memory_order_relaxed) && info.id == id) return *info.name;
+        }
+        return asyncName_;
+    }
+
+    bool Threads::setAffinity(const int32_t cpu) {
+        bool pinned = false;
+#if defined(_WIN32)
+        pinned = SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+        // macOS only takes affinity hints, so threads there stay unpinned
+
+        if (pinned && current_ && current_ != &overflow_) current_->cpu.store(cpu, std::memory_order_relaxed);
+        return pinned;
+    }
 }
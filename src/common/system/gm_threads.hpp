@@ -2,25 +2,72 @@
 
 #include "../headers/string.hpp"
 
+#include <array>
 #include <atomic>
-#include <string>
+#include <cstdint>
+#include <mutex>
 #include <thread>
-#include <unordered_map>
 
 namespace game {
+    enum THREAD_ROLES {
+        THREAD_MAIN,
+        THREAD_WORKER,
+        THREAD_IO,
+        THREAD_OTHER,
+    };
+
+    // What is known about a registered thread. Entries of exited threads are reused, but names are kept for the whole
+    // run, so references to them stay valid. Name, id and role are fixed once registered, the rest is updated by the
+    // thread itself.
+    typedef struct ThreadInfo_ {
+        const UTF8Str* name = nullptr;
+        std::thread::id id;
+        int32_t role = THREAD_OTHER;
+        std::atomic<int32_t> cpu = -1; // CPU the thread is pinned to, or -1 if it may run on any
+        std::atomic<void*> profile = nullptr; // The thread's Profiler buffer, once it has recorded a zone
+        std::atomic<bool> alive = false;
+    } ThreadInfo;
+
+    // Registry of named threads. Threads register themselves, and find their own entry through a thread_local pointer,
+    // so naming the current thread (as every log line does) takes no lock. Entries are claimed from a fixed table under
+    // a lock, reusing those of removed threads first.
     class Threads {
         public:
             // Functions
-            static void registerThread(const std::thread::id& id, const UTF8Str& name) { _threads[id] = name; }
-            static void removeThread(const std::thread::id& id) { _threads.erase(id); }
+            // Registers the calling thread. Threads register once, later calls return the existing entry unchanged.
+            static ThreadInfo& registerThread(const UTF8Str& name, const int32_t role);
+            static inline ThreadInfo& registerThread(const char*__restrict__ name, const int32_t role) {
+                return registerThread(UTF8Str{static_cast<int64_t>(std::strlen(name)), std::shared_ptr<const char>(name, [](const char*){})}, role);
+            }
+            // Marks the calling thread as exited, freeing its entry for the next thread. Its name stays valid.
+            static void removeThread();
 
-            static UTF8Str threadName(const std::thread::id& id) {
-                return _threads.contains(id) ? _threads.find(id)->second :
-                    UTF8Str{sizeof("Async") - 1, std::shared_ptr<const char>("Async", [](const char*){})};
+            // @return The calling thread's entry, or nullptr if it is not registered
+            static ThreadInfo* current();
+            // @return The name of the calling thread, or "Async" if it is not registered
+            static const UTF8Str& threadName();
+            static const UTF8Str& threadName(const std::thread::id& id);
+
+            // Pins the calling thread to @p cpu, and records it in the thread's entry.
+            // @return False if the system refused
+            static bool setAffinity(const int32_t cpu);
+
+            // Calls @p fn(info) for every registered thread that has not been removed.
+            template<typename F>
+            static void forEach(F&& fn) {
+                std::lock_guard lock(_threadsMtx);
+                for (uint32_t i = 0; i < _used; i++) {
+                    if (_threads[i].alive.load(std::memory_order_relaxed)) fn(static_cast<const ThreadInfo&>(_threads[i]));
+                }
             }
 
+            // Variables
+            static constexpr uint32_t MAX_THREADS = 256; // Threads registered while this many are alive are named "Async"
+
         private:
             // Variables
-            static std::unordered_map<std::thread::id, UTF8Str> _threads;
+            static std::array<ThreadInfo, MAX_THREADS> _threads;
+            static std::mutex _threadsMtx; // Guards claiming and freeing entries, and reading other threads' entries
+            static uint32_t _used; // Entries before this have been claimed at least once
     };
 }
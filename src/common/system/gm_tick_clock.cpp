@@ -0,0 +1,35 @@
+#include "gm_tick_clock.hpp"
+
+#include "../data/file/gm_logger.hpp"
+#include "../data/string/gm_format_string.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace game {
+    bool TickClock::tick() {
+        const Clock::time_point now = Clock::now();
+        if (now < _next) return false;
+
+        // Catching up on a long stall would stall the following ticks too, so drop what cannot be made up
+        const int64_t behind = (now - _next) / _tickLength;
+        if (behind >= MAX_CATCH_UP) {
+            Logger::log(LOG_WARN, FormatString::formatString("Running %ld ticks behind, skipping them.", behind));
+            _next = now;
+        }
+
+        _next += _tickLength;
+        _ticks++;
+        return true;
+    }
+
+    void TickClock::sleep() const {
+        std::this_thread::sleep_until(_next - SPIN_MARGIN);
+        while (Clock::now() < _next) std::this_thread::yield();
+    }
+
+    float64_t TickClock::alpha() const {
+        const std::chrono::nanoseconds untilNext = _next - Clock::now();
+        return std::clamp(1. - static_cast<float64_t>(untilNext.count()) / _tickLength.count(), 0., 1.);
+    }
+}
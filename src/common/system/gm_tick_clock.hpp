@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../headers/float.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace game {
+    // Fixed timestep on the monotonic clock, counted in whole nanoseconds so no lag accumulates from rounding.
+    // Loops call tick() until it returns false, then either render or sleep() until the next tick is due.
+    class TickClock {
+        public:
+            // Types
+            typedef std::chrono::steady_clock Clock;
+
+            // Constructors
+            TickClock(const std::chrono::nanoseconds tickLength) : _tickLength{tickLength} { reset(); }
+
+            // Functions
+            // @return True if a tick is due, which is then counted as done
+            bool tick();
+            // Sleeps until the next tick is due. Most of the wait is spent asleep in the kernel, and only the last
+            // SPIN_MARGIN yields, to make up for the scheduler waking the thread late.
+            void sleep() const;
+            // Starts counting from now, as if a tick just ran. Use after a long stall such as loading a world.
+            void reset() { _next = Clock::now() + _tickLength; }
+
+            // @return How far into the next tick the clock is, from 0 to 1, for interpolating rendering
+            float64_t alpha() const;
+            uint64_t ticks() const { return _ticks; }
+
+            // Variables
+            static constexpr std::chrono::microseconds SPIN_MARGIN{500};
+            static constexpr uint32_t MAX_CATCH_UP = 10; // Ticks to run late before skipping the rest
+
+        private:
+            // Variables
+            std::chrono::nanoseconds _tickLength;
+            Clock::time_point _next; // When the next tick is due
+            uint64_t _ticks = 0;
+    };
+}
@@ -1,5 +1,6 @@
 #include <common/gm_core.hpp>
 #include <common/data/file/gm_logger.hpp>
+#include <common/system/gm_profiler.hpp>
 #include <client/gm_client.hpp>
 
 #include <cstdlib>
@@ -13,8 +14,10 @@ int main (int argc, char** argv)
     Client::init();
     Client& client = Client::instance();
     client.start();
+    Profiler::exportTrace("../logs/trace.json");
 
     Logger::log(LOG_INFO, "Game exited successfully.");
+    Core::shutdown();
 
     return EXIT_SUCCESS;
 }
@@ -1,5 +1,6 @@
 #include <common/gm_core.hpp>
 #include <common/data/file/gm_logger.hpp>
+#include <common/system/gm_profiler.hpp>
 #include <server/gm_server_instance.hpp>
 
 using namespace game;
@@ -10,8 +11,10 @@ int main (int argc, char** argv)
     
     ServerInstance& server = ServerInstance::instance();
     server.start();
+    Profiler::exportTrace("../logs/_servertrace.json");
 
     Logger::log(LOG_INFO, "Server closed successfully.");
+    Core::shutdown();
 
     return EXIT_SUCCESS;
 }
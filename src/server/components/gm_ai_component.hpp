@@ -1,9 +1,10 @@
 #pragma once
 
+#include <server/components/gm_component_pool.hpp>
 #include <server/entities/gm_entity.hpp>
+#include <server/entities/gm_entity_commands.hpp>
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 namespace game {
@@ -22,26 +23,14 @@ namespace game {
             Entity _entity;
     };
 
-    class AIPool {
+    class AIPool : public ComponentPool<AIComponent> {
         public:
             // Constructors
             AIPool(EntityPool& entityPool, const size_t initialCapacity)
-                : _entityPool{entityPool}, _initialCapacity{initialCapacity} {}
+                : ComponentPool{entityPool, initialCapacity} {}
 
             // Functions
-            void create(const Entity entity);
-            void destroy(const size_t index);
-            AIComponent& get(const Entity entity) { return _pool[_indexMap[entity]]; }
-            size_t size() const { return _size; };
-
-            void update();
-
-        private:
-            // Variables
-            EntityPool& _entityPool;
-            size_t _initialCapacity;
-            std::unordered_map<Entity, size_t> _indexMap;
-            std::vector<AIComponent> _pool{_initialCapacity};
-            size_t _size = 0;
+            // Updates components in parallel. Components that finish are destroyed through @p commands afterwards.
+            void update(EntityCommands& commands);
     };
 }
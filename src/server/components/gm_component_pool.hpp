@@ -0,0 +1,69 @@
+#pragma once
+
+#include <server/entities/gm_entity.hpp>
+#include <server/entities/gm_sparse_set.hpp>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace game {
+    // Storage shared by every component pool. Components are packed in the order of the pool's sparse set,
+    // so get() is two array loads and updates walk a contiguous array.
+    template<typename T>
+    class ComponentPool {
+        public:
+            // Constructors
+            ComponentPool(EntityPool& entityPool, const size_t initialCapacity) : _entityPool{entityPool} {
+                _set.reserve(initialCapacity);
+                _components.reserve(initialCapacity);
+            }
+
+            // Functions
+            template<typename... Args>
+            T& create(const Entity entity, Args&&... args) {
+                _set.insert(entity);
+                return _components.emplace_back(entity, std::forward<Args>(args)...);
+            }
+
+            // Removes the component at @p index and kills its entity. The last component is moved to @p index.
+            void destroy(const size_t index) {
+                const Entity entity = _set.entity(index);
+                remove(index);
+                _entityPool.destroy(entity); // Kill the entity
+            }
+
+            // Removes the component at @p index, leaving its entity alive. The last component is moved to @p index.
+            void remove(const size_t index) {
+                if (index != _components.size() - 1) _components[index] = std::move(_components.back());
+                _components.pop_back();
+                _set.removeAt(index);
+            }
+
+            T& get(const Entity entity) { return _components[_set.index(entity)]; }
+            const T& get(const Entity entity) const { return _components[_set.index(entity)]; }
+            T* find(const Entity entity) {
+                const size_t index = _set.index(entity);
+                return index == SparseSet::NULL_INDEX ? nullptr : &_components[index];
+            }
+            bool contains(const Entity entity) const { return _set.contains(entity); }
+            size_t indexOf(const Entity entity) const { return _set.index(entity); }
+
+            size_t size() const { return _components.size(); }
+            T& operator[](const size_t index) { return _components[index]; }
+            const T& operator[](const size_t index) const { return _components[index]; }
+            Entity entity(const size_t index) const { return _set.entity(index); }
+
+            typename std::vector<T>::iterator begin() { return _components.begin(); }
+            typename std::vector<T>::iterator end() { return _components.end(); }
+
+            // Variables
+            static constexpr size_t UPDATE_GRAIN = 256; // Components per job in parallel updates
+
+        protected:
+            // Variables
+            EntityPool& _entityPool;
+            SparseSet _set;
+            std::vector<T> _components;
+    };
+}
@@ -1,34 +1,299 @@
 #include "gm_physics_component.hpp"
 
+#include <common/system/gm_jobs.hpp>
+#include <server/entities/gm_sparse_set.hpp>
+#include <server/world/gm_block.hpp>
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
 namespace game {
+    // Directions a body may be pushed in, one bit per axis and sign: bit 2 * axis for negative, 2 * axis + 1 for positive
+    static constexpr uint8_t ALL_DIRECTIONS_ = 0x3f;
+
     // PhysicsComponent //
-    PhysicsComponent::PhysicsComponent(const Entity entity) : _entity{entity} {
+    PhysicsComponent::PhysicsComponent(const Entity entity, const glm::dvec3& halfExtents, const float64_t inverseMass)
+        : _entity{entity}, _halfExtents{halfExtents}, _inverseMass{inverseMass} {
 
     }
 
-    bool PhysicsComponent::update() {
-        return false;
+    // PhysicsPool //
+    void PhysicsPool::update(TransformPool& transforms, const float64_t dt) {
+        gather(transforms);
+        if (_terrain) Jobs::parallelFor(_components.size(), UPDATE_GRAIN, [&](const size_t begin, const size_t end) {
+            sweepTerrain(begin, end, dt);
+        });
+        broadphase();
+        solvePairs();
+        if (_terrain) Jobs::parallelFor(_components.size(), UPDATE_GRAIN, [&](const size_t begin, const size_t end) {
+            solveTerrain(begin, end);
+        });
+
+        // Gravity comes last, so bodies resting on something are pushed back out of it by the next step
+        // before their velocity builds up
+        const float64_t fall = GRAVITY * dt;
+        for (size_t i = 0; i < _components.size(); i++) {
+            if (_inverseMasses[i] > 0.) _velocity[1][i] = std::max(_velocity[1][i] - fall, -TERMINAL_VELOCITY);
+        }
+
+        scatter(transforms);
     }
 
-    // PhysicsPool //
-    void PhysicsPool::create(const Entity entity) {
-        _pool.emplace_back(entity);
-        _indexMap[entity] = _size++;
+    void PhysicsPool::gather(TransformPool& transforms) {
+        const size_t count = _components.size();
+        _transformIndices.resize(count);
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            _min[axis].resize(count);
+            _max[axis].resize(count);
+            _velocity[axis].resize(count);
+        }
+        _inverseMasses.resize(count);
+        _moved.assign(count, 0);
+        _grounded.assign(count, 0);
+
+        const glm::dvec3* positions = transforms.positions();
+        const glm::dvec3* velocities = transforms.velocities();
+        for (size_t i = 0; i < count; i++) {
+            const PhysicsComponent& body = _components[i];
+            const size_t transform = transforms.indexOf(body._entity);
+            _transformIndices[i] = static_cast<uint32_t>(transform);
+            if (transform == SparseSet::NULL_INDEX) {
+                // Sorted after every real body, and never overlapping anything
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                    _min[axis][i] = std::numeric_limits<float64_t>::infinity();
+                    _max[axis][i] = -std::numeric_limits<float64_t>::infinity();
+                    _velocity[axis][i] = 0.;
+                }
+                _inverseMasses[i] = 0.;
+                continue;
+            }
+
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                _min[axis][i] = positions[transform][axis] - body._halfExtents[axis];
+                _max[axis][i] = positions[transform][axis] + body._halfExtents[axis];
+                _velocity[axis][i] = velocities[transform][axis];
+            }
+            _inverseMasses[i] = body._inverseMass;
+        }
+
+        if (_order.size() != count) {
+            // Bodies were added or removed, so indices past the old count are new and any order is a starting point
+            _order.resize(count);
+            std::iota(_order.begin(), _order.end(), 0);
+        }
     }
 
-    void PhysicsPool::destroy(const size_t index) {
-        Entity entity = _pool[index].entity();
-        Entity last = _pool[--_size].entity();
-        std::swap(_pool[index], _pool[_size]); // Swap last entity to index
-        _indexMap[last] = index; // Update the index of the moved entity
-        _indexMap.erase(entity); // Release the index held by the index map
-        _pool.erase(_pool.end() - 1); // Free the destroyed component's data from the pool
-        _entityPool.destroy(entity); // Kill the entity
+    void PhysicsPool::sweepTerrain(const size_t begin, const size_t end, const float64_t dt) {
+        // Bodies in x order share the chunks they are in, which keeps the query's chunk cache warm
+        TerrainQuery query{*_terrain};
+        for (size_t k = begin; k < end; k++) {
+            const uint32_t i = _order[k];
+            if (_inverseMasses[i] <= 0.) continue;
+
+            // Integration already moved the body, so go back to where it started and sweep it along the same motion
+            glm::dvec3 motion{_velocity[0][i] * dt, _velocity[1][i] * dt, _velocity[2][i] * dt};
+            const glm::dvec3 integrated = motion;
+            glm::dvec3 min{_min[0][i] - motion.x, _min[1][i] - motion.y, _min[2][i] - motion.z};
+            glm::dvec3 max{_max[0][i] - motion.x, _max[1][i] - motion.y, _max[2][i] - motion.z};
+            const uint8_t blocked = query.sweep(min, max, motion);
+            if (!blocked) continue;
+
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                _min[axis][i] = min[axis];
+                _max[axis][i] = max[axis];
+                if ((blocked >> axis) & 1) _velocity[axis][i] = 0.;
+            }
+            if ((blocked >> 1) & 1 && integrated.y < 0.) _grounded[i] = 1;
+            _moved[i] = 1;
+        }
     }
 
-    void PhysicsPool::update() {
-        for (size_t i = 0; i < _pool.size(); i++) {
-            if (_pool[i].update()) destroy(i);
+    void PhysicsPool::broadphase() {
+        const size_t count = _components.size();
+
+        // Bodies barely move between steps, so the order from the last step is almost sorted
+        const std::vector<float64_t>& minX = _min[0];
+        for (size_t i = 1; i < count; i++) {
+            const uint32_t body = _order[i];
+            const float64_t key = minX[body];
+            size_t j = i;
+            for (; j > 0 && minX[_order[j - 1]] > key; j--) _order[j] = _order[j - 1];
+            _order[j] = body;
         }
+
+        // Bodies whose x interval is still open as the sweep moves right
+        _pairs.clear();
+        std::vector<uint32_t> active;
+        for (const uint32_t body : _order) {
+            if (_transformIndices[body] == SparseSet::NULL_INDEX) break; // Sorted last
+            const float64_t start = minX[body];
+            for (size_t i = 0; i < active.size();) {
+                if (_max[0][active[i]] < start) {
+                    active[i] = active.back();
+                    active.pop_back();
+                    continue;
+                }
+
+                const uint32_t other = active[i++];
+                if (_min[1][body] < _max[1][other] && _min[1][other] < _max[1][body] &&
+                    _min[2][body] < _max[2][other] && _min[2][other] < _max[2][body]
+                ) _pairs.emplace_back(other, body);
+            }
+            active.push_back(body);
+        }
+
+        _contacts.clear();
+        for (const auto& [a, b] : _pairs) _contacts.emplace_back(_components[a]._entity, _components[b]._entity);
+    }
+
+    void PhysicsPool::solvePairs() {
+        // Pairs share bodies, so they are solved in order, and repeated so pushing one pair apart does not leave
+        // another overlapping
+        for (uint32_t iteration = 0; iteration < SOLVER_ITERATIONS; iteration++) {
+            bool separated = false;
+            for (const auto& [a, b] : _pairs) {
+                const float64_t totalMass = _inverseMasses[a] + _inverseMasses[b];
+                if (totalMass <= 0.) continue;
+
+                const float64_t otherMin[3] = {_min[0][b], _min[1][b], _min[2][b]};
+                const float64_t otherMax[3] = {_max[0][b], _max[1][b], _max[2][b]};
+                uint32_t axis;
+                float64_t distance;
+                if (!penetration(a, otherMin, otherMax, ALL_DIRECTIONS_, axis, distance)) continue;
+                separated = true;
+
+                move(a, axis, distance * _inverseMasses[a] / totalMass);
+                move(b, axis, -distance * _inverseMasses[b] / totalMass);
+                if (distance > 0. && axis == 1) _grounded[a] = 1;
+                if (distance < 0. && axis == 1) _grounded[b] = 1;
+
+                // Remove the velocity that closes the gap, sharing the change by inverse mass
+                const float64_t closing = (_velocity[axis][a] - _velocity[axis][b]) * (distance > 0. ? 1. : -1.);
+                if (closing < 0.) {
+                    const float64_t impulse = (_velocity[axis][a] - _velocity[axis][b]) / totalMass;
+                    _velocity[axis][a] -= impulse * _inverseMasses[a];
+                    _velocity[axis][b] += impulse * _inverseMasses[b];
+                }
+            }
+            if (!separated) break;
+        }
+    }
+
+    void PhysicsPool::solveTerrain(const size_t begin, const size_t end) {
+        TerrainQuery query{*_terrain};
+        for (size_t k = begin; k < end; k++) {
+            const uint32_t i = _order[k];
+            if (_inverseMasses[i] <= 0.) continue;
+
+            for (uint32_t iteration = 0; iteration < TERRAIN_ITERATIONS; iteration++) {
+                // Push out of the block overlapping the most first. It is the one under or beside the body's centre, so
+                // resolving it first keeps the body from catching on the seams between neighbouring blocks.
+                int32_t lo[3], hi[3];
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                    lo[axis] = static_cast<int32_t>(std::floor(_min[axis][i]));
+                    hi[axis] = static_cast<int32_t>(std::ceil(_max[axis][i])) - 1;
+                }
+
+                float64_t deepest = 0.;
+                int32_t block[3];
+                for (int32_t x = lo[0]; x <= hi[0]; x++) {
+                    for (int32_t y = lo[1]; y <= hi[1]; y++) {
+                        for (int32_t z = lo[2]; z <= hi[2]; z++) {
+                            if (!query.solid(x, y, z)) continue;
+
+                            const int32_t at[3] = {x, y, z};
+                            float64_t volume = 1.;
+                            for (uint32_t axis = 0; axis < 3; axis++) {
+                                volume *= std::min(_max[axis][i], at[axis] + 1.) - std::max(_min[axis][i], static_cast<float64_t>(at[axis]));
+                            }
+                            if (volume <= deepest) continue;
+                            deepest = volume;
+                            block[0] = x;
+                            block[1] = y;
+                            block[2] = z;
+                        }
+                    }
+                }
+                if (deepest <= 0.) break;
+
+                // Faces shared with another solid block are inside the terrain, so never push through them
+                uint8_t directions = 0;
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                    for (int32_t sign = -1; sign <= 1; sign += 2) {
+                        int32_t neighbour[3] = {block[0], block[1], block[2]};
+                        neighbour[axis] += sign;
+                        if (!query.solid(neighbour[0], neighbour[1], neighbour[2])) {
+                            directions |= static_cast<uint8_t>(1 << (2 * axis + (sign > 0)));
+                        }
+                    }
+                }
+                if (directions == 0) {
+                    // Buried, so back out the way the body came in
+                    for (uint32_t axis = 0; axis < 3; axis++) {
+                        if (_velocity[axis][i] < 0.) directions |= static_cast<uint8_t>(1 << (2 * axis + 1));
+                        else if (_velocity[axis][i] > 0.) directions |= static_cast<uint8_t>(1 << (2 * axis));
+                    }
+                    if (directions == 0) directions = ALL_DIRECTIONS_;
+                }
+
+                const float64_t blockMin[3] = {static_cast<float64_t>(block[0]), static_cast<float64_t>(block[1]), static_cast<float64_t>(block[2])};
+                const float64_t blockMax[3] = {blockMin[0] + 1., blockMin[1] + 1., blockMin[2] + 1.};
+                uint32_t axis;
+                float64_t distance;
+                if (!penetration(i, blockMin, blockMax, directions, axis, distance)) break;
+
+                move(i, axis, distance);
+                if (axis == 1 && distance > 0.) _grounded[i] = 1;
+                if (_velocity[axis][i] * distance < 0.) _velocity[axis][i] = 0.;
+            }
+        }
+    }
+
+    void PhysicsPool::scatter(TransformPool& transforms) {
+        glm::dvec3* positions = transforms.positions();
+        glm::dvec3* velocities = transforms.velocities();
+        for (size_t i = 0; i < _components.size(); i++) {
+            _components[i]._onGround = _grounded[i];
+            const uint32_t transform = _transformIndices[i];
+            if (transform == SparseSet::NULL_INDEX) continue;
+
+            velocities[transform] = glm::dvec3{_velocity[0][i], _velocity[1][i], _velocity[2][i]};
+            if (!_moved[i]) continue;
+            positions[transform] = glm::dvec3{
+                (_min[0][i] + _max[0][i]) * 0.5, (_min[1][i] + _max[1][i]) * 0.5, (_min[2][i] + _max[2][i]) * 0.5
+            };
+            transforms.markDirty(transform);
+        }
+    }
+
+    bool PhysicsPool::penetration(const size_t i, const float64_t* otherMin, const float64_t* otherMax,
+        const uint8_t directions, uint32_t& axis, float64_t& distance
+    ) const {
+        float64_t best = std::numeric_limits<float64_t>::infinity();
+        for (uint32_t a = 0; a < 3; a++) {
+            if (_min[a][i] >= otherMax[a] || otherMin[a] >= _max[a][i]) return false;
+
+            // Distance to move to clear the other box on each side
+            const float64_t down = otherMin[a] - _max[a][i] - SKIN;
+            const float64_t up = otherMax[a] - _min[a][i] + SKIN;
+            if ((directions >> (2 * a)) & 1 && -down < best) {
+                best = -down;
+                axis = a;
+                distance = down;
+            }
+            if ((directions >> (2 * a + 1)) & 1 && up < best) {
+                best = up;
+                axis = a;
+                distance = up;
+            }
+        }
+        return best != std::numeric_limits<float64_t>::infinity();
+    }
+
+    void PhysicsPool::move(const size_t i, const uint32_t axis, const float64_t distance) {
+        _min[axis][i] += distance;
+        _max[axis][i] += distance;
+        _moved[i] = 1;
     }
 }
@@ -2,7 +2,11 @@
 
 #include "gm_transform_component.hpp"
 
+#include <common/headers/float.hpp>
+#include <server/components/gm_component_pool.hpp>
 #include <server/entities/gm_entity.hpp>
+#include <server/world/gm_chunk_map.hpp>
+#include <server/world/gm_terrain_query.hpp>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -10,73 +14,113 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <algorithm>
-#include <string>
+#include <cstdint>
+#include <utility>
 #include <vector>
-#include <unordered_map>
 
 namespace game {
+    // An axis-aligned box centred on its entity's transform position, which collides with solid blocks and other bodies.
+    // Bodies with an inverse mass of 0 are never pushed, but still push the bodies that touch them.
     class PhysicsComponent {
         public:
             // Constructors
-            PhysicsComponent(const Entity entity);
+            PhysicsComponent(const Entity entity) : PhysicsComponent{entity, DEFAULT_HALF_EXTENTS, 1.} {}
+            PhysicsComponent(const Entity entity, const glm::dvec3& halfExtents, const float64_t inverseMass);
 
             // Functions
-            bool update();
-
-            void setParent(const Entity parent) { _parent = parent; }
-            void addChild(const Entity child) { _children.push_back(child); }
-            void removeChild(const Entity child) { _children.erase(std::find(_children.begin(), _children.end(), child)); }
-            void removeFirstChild() { _children.erase(_children.begin()); }
-            void removeLastChild() { _children.erase(_children.end()); }
-
-            void setSpeed(const WorldTransform& speedTransform) {
-                _speedTransform = speedTransform;
-                _speedTransform.dirty = true;
-            }
-            void setAcceleration(const WorldTransform& accelerationTransform) {
-                _accelerationTransform = accelerationTransform;
-                _accelerationTransform.dirty = true;
-            }
-
             Entity entity() const { return _entity; }
-            Entity parent() const { return _parent; }
-            std::vector<Entity> children() const { return _children; }
 
-            WorldTransform speedTransform() const { return _speedTransform; }
-            WorldTransform accelerationTransform() const { return _accelerationTransform; }
+            const glm::dvec3& halfExtents() const { return _halfExtents; }
+            void setHalfExtents(const glm::dvec3& halfExtents) { _halfExtents = halfExtents; }
+            float64_t inverseMass() const { return _inverseMass; }
+            void setInverseMass(const float64_t inverseMass) { _inverseMass = inverseMass; }
+            // @return True if the body rested on a block or another body after the last step
+            bool onGround() const { return _onGround; }
 
             // Variables
             static constexpr WorldTransform origin{};
-        
+            static constexpr glm::dvec3 DEFAULT_HALF_EXTENTS{0.3, 0.9, 0.3};
+
         private:
+            friend class PhysicsPool;
+
             // Variables
             Entity _entity;
-
-            Entity _parent;
-            std::vector<Entity> _children;
-            
-            WorldTransform _speedTransform{};
-            WorldTransform _accelerationTransform{};
+            glm::dvec3 _halfExtents;
+            float64_t _inverseMass;
+            bool _onGround = false;
     };
 
-    class PhysicsPool {
+    // Steps every body once per tick, after transforms have been integrated:
+    // 1. Boxes are gathered into separate min, max and velocity arrays per axis.
+    // 2. Each body's motion this tick is swept against solid blocks, so fast bodies stop at the first block in their
+    //    way instead of passing through it, and lose their velocity on the axes that were stopped.
+    // 3. Sweep and prune finds the pairs whose boxes overlap. Bodies stay sorted by their lower x bound between steps,
+    //    so the insertion sort that keeps them sorted is close to linear.
+    // 4. Overlapping pairs are pushed apart along their axis of least penetration, split by inverse mass, and lose
+    //    the velocity that moves them into each other.
+    // 5. Bodies pushed into solid blocks by each other are pushed back out the same way.
+    // 6. Gravity is added to the velocity of every body that can be pushed, for the next integration.
+    // Steps 2 and 5 run in parallel, since each body only writes its own arrays.
+    // Bodies move their transform's local position, so bodies should be on root transforms.
+    class PhysicsPool : public ComponentPool<PhysicsComponent> {
         public:
+            // Types
+            typedef std::pair<Entity, Entity> Contact;
+
             // Constructors
-            PhysicsPool(EntityPool& entityPool) : _entityPool{entityPool} {}
+            PhysicsPool(EntityPool& entityPool)
+                : ComponentPool{entityPool, 64} {}
 
             // Functions
-            void create(const Entity entity);
-            void destroy(const size_t index);
-            PhysicsComponent& get(const Entity entity) { return _pool[_indexMap[entity]]; }
-            size_t size() const { return _size; };
+            // Solid blocks come from @p terrain, or bodies only collide with each other if it is nullptr.
+            void setTerrain(const ChunkMap* terrain) { _terrain = terrain; }
 
-            void update();
+            // Resolves contacts and applies gravity for the step of @p dt seconds that @p transforms just integrated.
+            void update(TransformPool& transforms, const float64_t dt);
+
+            // Pairs of bodies whose boxes overlapped during the last update()
+            const std::vector<Contact>& contacts() const { return _contacts; }
+
+            // Variables
+            static constexpr float64_t GRAVITY = 32.; // Blocks per second squared
+            static constexpr float64_t TERMINAL_VELOCITY = 60.; // Fastest gravity makes a body fall, in blocks per second
+            static constexpr uint32_t SOLVER_ITERATIONS = 4; // Passes over the overlapping pairs
+            static constexpr uint32_t TERRAIN_ITERATIONS = 4; // Blocks a body may be pushed back out of per step
+            static constexpr float64_t SKIN = TerrainQuery::SKIN; // Gap left after pushing a body out, so it does not overlap again
 
         private:
+            // Functions
+            void gather(TransformPool& transforms);
+            // Bodies [@p begin, @p end) in x order, over the @p dt seconds of motion integration just made.
+            void sweepTerrain(const size_t begin, const size_t end, const float64_t dt);
+            void broadphase();
+            void solvePairs();
+            // Bodies [@p begin, @p end) in x order.
+            void solveTerrain(const size_t begin, const size_t end);
+            void scatter(TransformPool& transforms);
+
+            // Finds the shortest push that moves body @p i clear of the box [@p otherMin, @p otherMax), among the
+            // directions set in @p directions (bit 2 * axis for negative, 2 * axis + 1 for positive).
+            // @return False if the boxes do not overlap or no direction is allowed
+            bool penetration(const size_t i, const float64_t* otherMin, const float64_t* otherMax, const uint8_t directions,
+                uint32_t& axis, float64_t& distance) const;
+            void move(const size_t i, const uint32_t axis, const float64_t distance);
+
             // Variables
-            EntityPool& _entityPool;
-            std::unordered_map<Entity, size_t> _indexMap;
-            std::vector<PhysicsComponent> _pool{64};
-            size_t _size = 0;
+            const ChunkMap* _terrain = nullptr;
+            std::vector<Contact> _contacts;
+
+            // Per body, in component order, rebuilt by every update()
+            std::vector<uint32_t> _transformIndices; // SparseSet::NULL_INDEX for bodies without a transform
+            std::vector<float64_t> _min[3];
+            std::vector<float64_t> _max[3];
+            std::vector<float64_t> _velocity[3];
+            std::vector<float64_t> _inverseMasses;
+            std::vector<uint8_t> _moved;
+            std::vector<uint8_t> _grounded;
+
+            std::vector<uint32_t> _order; // Body indices sorted by lower x bound, kept between steps
+            std::vector<std::pair<uint32_t, uint32_t>> _pairs;
     };
 }
@@ -1,23 +1,59 @@
 #include "gm_server_components.hpp"
 
-#include <thread>
+#include <common/gm_core.hpp>
+#include <common/system/gm_jobs.hpp>
+#include <common/system/gm_profiler.hpp>
+
 #include <vector>
 
 namespace game {
+    ServerComponents::ServerComponents(EntityPool& entityPool) : _entityPool{entityPool} {
+        const AccessMask ai = ComponentTypes::mask<AIComponent>();
+        const AccessMask transform = ComponentTypes::mask<WorldTransform>();
+        const AccessMask physics = ComponentTypes::mask<PhysicsComponent>();
+        const AccessMask spatial = ComponentTypes::mask<SpatialGrid::Access>();
+
+        // Update entities. Deferred commands are thread safe, so recording them is not a write.
+        _scheduler.add("AI", 0, ai, [this] { _ai.update(_commands); });
+
+        // Apply what the updates deferred once nothing else runs
+        _scheduler.add("Commands", 0, Scheduler::ALL, [this] {
+            _commands.apply(_entityPool, [this] (const Entity entity) { destroy(entity); });
+        });
+
+        // Move transforms, which spreads over the workers itself, push bodies out of what they moved into, then carry
+        // changes down the hierarchy
+        _scheduler.add("Integrate", 0, transform, [this] { _transform.integrate(Core::MS_PER_TICK / 1000.); });
+        _scheduler.add("Physics", 0, transform | physics, [this] { _physics.update(_transform, Core::MS_PER_TICK / 1000.); });
+        _scheduler.add("Propagate", 0, transform, [this] { _transform.propagate(); });
+
+        // Re-bucket what moved, for queries by position
+        _scheduler.add("Spatial", transform, spatial, [this] { _spatial.update(_transform); });
+    }
+
     void ServerComponents::update() {
-        std::vector<std::thread> tasks;
-
-        // Update entities
-        std::thread aiTask([&] (AIPool& pool) {
-            pool.update();
-        }, std::ref(_ai));
-        /*std::thread physicsTask([&] (PhysicsPool& pool) {
-            pool.update();
-        }, std::ref(physics_));
-        */
-
-        // Wait for threads
-        aiTask.join();
-        //physicsTask.join();
+        PROFILE_ZONE("ServerComponents::update");
+        _transform.clearDirty();
+        _commands.begin();
+        _scheduler.run();
+    }
+
+    void ServerComponents::destroy(const Entity entity) {
+        // Children are destroyed with their parent
+        std::vector<Entity> entities{entity};
+        const size_t transformIndex = _transform.indexOf(entity);
+        if (transformIndex != SparseSet::NULL_INDEX) {
+            for (size_t i = transformIndex + 1; i < transformIndex + _transform.subtreeSize(transformIndex); i++) {
+                entities.push_back(_transform.entity(i));
+            }
+            _transform.remove(transformIndex);
+        }
+
+        for (const Entity destroyed : entities) {
+            if (const size_t index = _ai.indexOf(destroyed); index != SparseSet::NULL_INDEX) _ai.remove(index);
+            if (const size_t index = _physics.indexOf(destroyed); index != SparseSet::NULL_INDEX) _physics.remove(index);
+            _spatial.remove(destroyed);
+            _entityPool.destroy(destroyed); // Kill the entity
+        }
     }
 }
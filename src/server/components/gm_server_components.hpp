@@ -1,26 +1,48 @@
 #pragma once
 
 #include "gm_ai_component.hpp"
+#include "gm_physics_component.hpp"
+#include "gm_spatial_grid.hpp"
 #include "gm_transform_component.hpp"
+#include <server/entities/gm_component_types.hpp>
 #include <server/entities/gm_entity.hpp>
+#include <server/entities/gm_entity_commands.hpp>
+#include <common/system/gm_scheduler.hpp>
 
 namespace game {
     class ServerComponents{
         public:
             // Constructors
-            ServerComponents(EntityPool entityPool) : _entityPool{entityPool} {}
-        
-            
+            ServerComponents(EntityPool& entityPool);
+
+            ServerComponents(const ServerComponents &) = delete;
+            ServerComponents &operator=(const ServerComponents &) = delete;
+
             // Functions
+            // Runs every system once through the scheduler.
             void update();
+
+            // Removes every component of @p entity and its transform's descendants, and kills them.
+            // Must not be called during update(), record destruction in commands() instead.
+            void destroy(const Entity entity);
             
             AIPool& ai() { return _ai; }
+            PhysicsPool& physics() { return _physics; }
             TransformPool& transform() { return _transform; }
+            // Entities by world position, up to date once the scheduler has run
+            SpatialGrid& spatial() { return _spatial; }
+            // Creation and destruction deferred until the end of the current component pass
+            EntityCommands& commands() { return _commands; }
+            Scheduler& scheduler() { return _scheduler; }
             
         private:
             // Variables
             EntityPool& _entityPool;
             AIPool _ai{_entityPool, 256};
+            PhysicsPool _physics{_entityPool};
             TransformPool _transform{_entityPool, 256};
+            SpatialGrid _spatial{SpatialGrid::DEFAULT_CELL_SIZE};
+            EntityCommands _commands;
+            Scheduler _scheduler;
     };
 }
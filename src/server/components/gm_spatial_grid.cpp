@@ -0,0 +1,198 @@
+#include "gm_spatial_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+namespace game {
+    void SpatialGrid::update(const TransformPool& transforms) {
+        const size_t count = transforms.size();
+        const glm::dvec3* positions = transforms.worldPositions();
+        for (size_t word = 0; word * 64 < count; word++) {
+            for (uint64_t bits = transforms.dirtyWord(word); bits; bits &= bits - 1) {
+                const size_t i = word * 64 + __builtin_ctzll(bits);
+                set(transforms.entity(i), positions[i]);
+            }
+        }
+
+        // Transforms created before their dirty bits were last cleared were never seen, so look for them
+        if (_size < count) {
+            for (size_t i = 0; i < count; i++) {
+                if (!contains(transforms.entity(i))) set(transforms.entity(i), positions[i]);
+            }
+        }
+    }
+
+    void SpatialGrid::set(const Entity entity, const glm::dvec3& position) {
+        const uint32_t index = EntityPool::entityIndex(entity);
+        if (index >= _entries.size()) _entries.resize(index + 1);
+
+        Entry& entry = _entries[index];
+        const CellKey cellKey = keyOf(position);
+        if (entry.entity == entity) {
+            if (entry.cell == cellKey) {
+                _cells[cellKey].positions[entry.slot] = position;
+                return;
+            }
+            removeFromCell(entry);
+        } else {
+            // A stale entry of a destroyed entity whose index was reused is replaced
+            if (entry.entity != EntityPool::NULL_ENTITY) removeFromCell(entry);
+            else _size++;
+        }
+
+        const auto [found, added] = _cells.try_emplace(cellKey);
+        if (added) {
+            const int32_t coords[3] = {cellCoord(position.x), cellCoord(position.y), cellCoord(position.z)};
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                _occupiedMin[axis] = std::min(_occupiedMin[axis], coords[axis]);
+                _occupiedMax[axis] = std::max(_occupiedMax[axis], coords[axis]);
+            }
+        }
+
+        Cell& cell = found->second;
+        entry = Entry{entity, cellKey, static_cast<uint32_t>(cell.entities.size())};
+        cell.entities.push_back(entity);
+        cell.positions.push_back(position);
+    }
+
+    void SpatialGrid::remove(const Entity entity) {
+        if (!contains(entity)) return;
+
+        Entry& entry = _entries[EntityPool::entityIndex(entity)];
+        removeFromCell(entry);
+        entry.entity = EntityPool::NULL_ENTITY;
+        _size--;
+    }
+
+    void SpatialGrid::removeFromCell(const Entry& entry) {
+        const auto found = _cells.find(entry.cell);
+        Cell& cell = found->second;
+
+        // Move the last entity of the cell into the freed slot
+        const Entity last = cell.entities.back();
+        cell.entities[entry.slot] = last;
+        cell.positions[entry.slot] = cell.positions.back();
+        _entries[EntityPool::entityIndex(last)].slot = entry.slot;
+        cell.entities.pop_back();
+        cell.positions.pop_back();
+        if (cell.entities.empty()) _cells.erase(found);
+        if (_cells.empty()) {
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                _occupiedMin[axis] = CELL_COORD_LIMIT;
+                _occupiedMax[axis] = -CELL_COORD_LIMIT;
+            }
+        }
+    }
+
+    void SpatialGrid::queryRadius(const glm::dvec3& center, const float64_t radius, std::vector<Entity>& results) const {
+        const glm::dvec3 extent(radius, radius, radius);
+        const float64_t radiusSquared = radius * radius;
+        forEachCell(center - extent, center + extent, [&](const Cell& cell) {
+            for (size_t i = 0; i < cell.entities.size(); i++) {
+                const glm::dvec3 offset = cell.positions[i] - center;
+                if (glm::dot(offset, offset) <= radiusSquared) results.push_back(cell.entities[i]);
+            }
+        });
+    }
+
+    void SpatialGrid::queryBox(const glm::dvec3& min, const glm::dvec3& max, std::vector<Entity>& results) const {
+        forEachCell(min, max, [&](const Cell& cell) {
+            for (size_t i = 0; i < cell.entities.size(); i++) {
+                const glm::dvec3& p = cell.positions[i];
+                if (p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z) {
+                    results.push_back(cell.entities[i]);
+                }
+            }
+        });
+    }
+
+    Entity SpatialGrid::raycast(const glm::dvec3& origin, const glm::dvec3& direction, const float64_t maxDistance,
+        const float64_t radius, float64_t* distance
+    ) const {
+        const float64_t length = glm::length(direction);
+        if (length == 0. || _cells.empty()) return EntityPool::NULL_ENTITY;
+        const glm::dvec3 dir = direction / length;
+
+        Entity nearest = EntityPool::NULL_ENTITY;
+        float64_t best = maxDistance;
+        const float64_t radiusSquared = radius * radius;
+        auto test = [&](const Cell& cell) {
+            for (size_t i = 0; i < cell.entities.size(); i++) {
+                const glm::dvec3 offset = cell.positions[i] - origin;
+                const float64_t along = glm::dot(offset, dir);
+                const float64_t offsetSquared = glm::dot(offset, offset);
+                const float64_t missSquared = offsetSquared - along * along;
+                if (missSquared > radiusSquared || (along < 0. && offsetSquared > radiusSquared)) continue;
+
+                // Where the ray enters the entity's sphere, or the origin if it starts inside
+                const float64_t hit = offsetSquared <= radiusSquared ? 0. : along - std::sqrt(radiusSquared - missSquared);
+                if (hit <= best) {
+                    best = hit;
+                    nearest = cell.entities[i];
+                }
+            }
+        };
+
+        // Walk the cells along the ray. An entity within the radius of the ray is at most one cell from the ray, so
+        // each cell's neighbours are checked too, and the walk ends once no unchecked entity could be hit sooner, or
+        // once the ray has left the cells that were ever occupied, which also bounds rays of infinite length.
+        int32_t cell[3] = {cellCoord(origin.x), cellCoord(origin.y), cellCoord(origin.z)};
+        int32_t step[3];
+        float64_t next[3], delta[3];
+        for (int32_t axis = 0; axis < 3; axis++) {
+            if (dir[axis] == 0.) {
+                step[axis] = 0;
+                next[axis] = delta[axis] = std::numeric_limits<float64_t>::infinity();
+                continue;
+            }
+            step[axis] = dir[axis] > 0. ? 1 : -1;
+            const float64_t boundary = (cell[axis] + (step[axis] > 0 ? 1 : 0)) * _cellSize;
+            next[axis] = (boundary - origin[axis]) / dir[axis];
+            delta[axis] = _cellSize / std::abs(dir[axis]);
+        }
+
+        std::unordered_set<CellKey> checked;
+        for (float64_t entered = 0.; entered <= best + radius;) {
+            for (int32_t dz = -1; dz <= 1; dz++) {
+                for (int32_t dy = -1; dy <= 1; dy++) {
+                    for (int32_t dx = -1; dx <= 1; dx++) {
+                        const CellKey neighbour = key(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+                        if (!checked.insert(neighbour).second) continue;
+                        const auto found = _cells.find(neighbour);
+                        if (found != _cells.end()) test(found->second);
+                    }
+                }
+            }
+
+            const int32_t axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+            entered = next[axis];
+            cell[axis] += step[axis];
+            next[axis] += delta[axis];
+
+            // Cells only ever move one way along each axis, so once past the occupied cells and their neighbours on
+            // any axis the ray never comes back to them
+            bool past = false;
+            for (int32_t a = 0; a < 3; a++) {
+                past |= (step[a] >= 0 && cell[a] > _occupiedMax[a] + 1) || (step[a] <= 0 && cell[a] < _occupiedMin[a] - 1);
+            }
+            if (past) break;
+        }
+
+        if (distance && nearest != EntityPool::NULL_ENTITY) *distance = best;
+        return nearest;
+    }
+
+    int32_t SpatialGrid::cellCoord(const float64_t coord) const {
+        const float64_t cell = std::floor(coord * _inverseCellSize);
+        return static_cast<int32_t>(std::clamp(cell, static_cast<float64_t>(-CELL_COORD_LIMIT), static_cast<float64_t>(CELL_COORD_LIMIT - 1)));
+    }
+
+    SpatialGrid::CellKey SpatialGrid::key(const int32_t x, const int32_t y, const int32_t z) {
+        auto bits = [](const int32_t coord) {
+            return static_cast<uint64_t>(std::clamp(coord, -CELL_COORD_LIMIT, CELL_COORD_LIMIT - 1) + CELL_COORD_LIMIT);
+        };
+        return (bits(x) << 42) | (bits(y) << 21) | bits(z);
+    }
+}
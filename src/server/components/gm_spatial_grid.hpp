@@ -0,0 +1,115 @@
+#pragma once
+
+#include "gm_transform_component.hpp"
+
+#include <common/headers/float.hpp>
+#include <server/entities/gm_entity.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace game {
+    // Buckets entities by the grid cell their world position is in, so queries only visit the cells they overlap
+    // instead of every entity. Cells are hashed, so only occupied cells take memory, and queries covering more cells
+    // than are occupied visit the occupied cells instead.
+    // Entities are points: callers looking for entities of some size pad their query by it.
+    class SpatialGrid {
+        public:
+            // Types
+            struct Access {}; // Stands for the grid in scheduler access masks, since the grid itself is not a component
+
+            // Constructors
+            SpatialGrid(const float64_t cellSize) : _cellSize{cellSize}, _inverseCellSize{1. / cellSize} {}
+
+            SpatialGrid(const SpatialGrid &) = delete;
+            SpatialGrid &operator=(const SpatialGrid &) = delete;
+
+            // Functions
+            // Moves every entity whose transform is dirty to its world position, adding it if it is new. Only the dirty
+            // words are visited, unless transforms were created while their dirty bits were not watched.
+            void update(const TransformPool& transforms);
+            // Adds @p entity at @p position, or moves it there.
+            void set(const Entity entity, const glm::dvec3& position);
+            void remove(const Entity entity);
+
+            bool contains(const Entity entity) const {
+                const uint32_t index = EntityPool::entityIndex(entity);
+                return index < _entries.size() && _entries[index].entity == entity;
+            }
+            size_t size() const { return _size; }
+            size_t cellCount() const { return _cells.size(); }
+
+            // Appends the entities within @p radius of @p center to @p results.
+            void queryRadius(const glm::dvec3& center, const float64_t radius, std::vector<Entity>& results) const;
+            // Appends the entities inside the box from @p min to @p max to @p results.
+            void queryBox(const glm::dvec3& min, const glm::dvec3& max, std::vector<Entity>& results) const;
+            // Finds the first entity the ray from @p origin along @p direction passes within @p radius of, up to
+            // @p maxDistance along the ray. @p radius must not exceed the cell size.
+            // @return The entity, or NULL_ENTITY if there is none. @p distance is set to how far along the ray it was hit.
+            Entity raycast(const glm::dvec3& origin, const glm::dvec3& direction, const float64_t maxDistance,
+                const float64_t radius, float64_t* distance) const;
+
+            // Variables
+            static constexpr float64_t DEFAULT_CELL_SIZE = 16.;
+
+        private:
+            // Types
+            typedef uint64_t CellKey;
+
+            typedef struct Cell_ {
+                std::vector<Entity> entities;
+                std::vector<glm::dvec3> positions; // Kept next to the entities, so filtering a cell reads one array
+            } Cell;
+
+            typedef struct Entry_ {
+                Entity entity = EntityPool::NULL_ENTITY;
+                CellKey cell;
+                uint32_t slot; // Index in the cell's arrays
+            } Entry;
+
+            // Functions
+            int32_t cellCoord(const float64_t coord) const;
+            // Coordinates are clamped to what fits in 21 bits each
+            static CellKey key(const int32_t x, const int32_t y, const int32_t z);
+            CellKey keyOf(const glm::dvec3& position) const {
+                return key(cellCoord(position.x), cellCoord(position.y), cellCoord(position.z));
+            }
+            void removeFromCell(const Entry& entry);
+
+            // Calls @p fn(cell) for every occupied cell overlapping the box from @p min to @p max.
+            template<typename F>
+            void forEachCell(const glm::dvec3& min, const glm::dvec3& max, F&& fn) const {
+                const int32_t minX = cellCoord(min.x), minY = cellCoord(min.y), minZ = cellCoord(min.z);
+                const int32_t maxX = cellCoord(max.x), maxY = cellCoord(max.y), maxZ = cellCoord(max.z);
+                const uint64_t cells = static_cast<uint64_t>(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+                if (cells > _cells.size()) {
+                    // Large ranges visit the occupied cells, which callers filter by position anyway
+                    for (const auto& [cellKey, cell] : _cells) fn(cell);
+                    return;
+                }
+
+                for (int32_t z = minZ; z <= maxZ; z++) {
+                    for (int32_t y = minY; y <= maxY; y++) {
+                        for (int32_t x = minX; x <= maxX; x++) {
+                            const auto found = _cells.find(key(x, y, z));
+                            if (found != _cells.end()) fn(found->second);
+                        }
+                    }
+                }
+            }
+
+            // Variables
+            static constexpr int32_t CELL_COORD_LIMIT = 1 << 20;
+
+            float64_t _cellSize;
+            float64_t _inverseCellSize;
+            std::unordered_map<CellKey, Cell> _cells; // Only occupied cells
+            // Cell coordinates around every cell occupied since the grid was last empty
+            int32_t _occupiedMin[3] = {CELL_COORD_LIMIT, CELL_COORD_LIMIT, CELL_COORD_LIMIT};
+            int32_t _occupiedMax[3] = {-CELL_COORD_LIMIT, -CELL_COORD_LIMIT, -CELL_COORD_LIMIT};
+            std::vector<Entry> _entries; // Indexed by entity index
+            size_t _size = 0;
+    };
+}
@@ -1,18 +1,271 @@
 #include "gm_transform_component.hpp"
 
+#include <common/system/gm_jobs.hpp>
+
+#include <algorithm>
+#include <cstring>
+
 namespace game {
-    void TransformPool::create(const Entity entity) {
-        _pool.emplace_back(entity);
-        _indexMap[entity] = _size++;
+    static_assert(sizeof(glm::dvec3) == 3 * sizeof(float64_t), "Integration treats vectors as flat arrays of doubles");
+
+    // Four doubles per operation, lowered to whatever SIMD the target has. Release builds are -Os, which does not
+    // auto-vectorise, so kernels use these directly.
+    typedef float64_t float64x4_t __attribute__((vector_size(4 * sizeof(float64_t))));
+
+    TransformPool::TransformPool(EntityPool& entityPool, const size_t initialCapacity) : _entityPool{entityPool} {
+        _set.reserve(initialCapacity);
+        _positions.reserve(initialCapacity);
+        _rotations.reserve(initialCapacity);
+        _scales.reserve(initialCapacity);
+        _velocities.reserve(initialCapacity);
+        _accelerations.reserve(initialCapacity);
+        _dirty.reserve((initialCapacity + 63) / 64);
+        _worldPositions.reserve(initialCapacity);
+        _worldRotations.reserve(initialCapacity);
+        _worldScales.reserve(initialCapacity);
+        _parents.reserve(initialCapacity);
+        _parentIndices.reserve(initialCapacity);
+        _subtreeSizes.reserve(initialCapacity);
+    }
+
+    size_t TransformPool::create(const Entity entity, const WorldTransform& transform) {
+        // New transforms are roots, so appending keeps parents before children
+        const size_t index = _set.insert(entity);
+        _positions.push_back(transform.position);
+        _rotations.push_back(transform.rotation);
+        _scales.push_back(transform.scale);
+        _velocities.emplace_back();
+        _accelerations.emplace_back();
+        _worldPositions.push_back(transform.position);
+        _worldRotations.push_back(transform.rotation);
+        _worldScales.push_back(transform.scale);
+        _parents.push_back(EntityPool::NULL_ENTITY);
+        _parentIndices.push_back(SparseSet::NULL_INDEX);
+        _subtreeSizes.push_back(1);
+        if (index / 64 >= _dirty.size()) _dirty.push_back(0);
+        markDirty(index); // New transforms have never been rendered
+        return index;
     }
 
     void TransformPool::destroy(const size_t index) {
-        Entity entity = _pool[index].entity();
-        Entity last = _pool[--_size].entity();
-        std::swap(_pool[index], _pool[_size]); // Swap last entity to index
-        _indexMap[last] = index; // Update the index of the moved entity
-        _indexMap.erase(entity); // Release the index held by the index map
-        _pool.erase(_pool.end() - 1); // Free the destroyed component's data from the pool
-        _entityPool.destroy(entity); // Kill the entity
+        const std::vector<Entity> entities(_set.entities().begin() + index, _set.entities().begin() + index + _subtreeSizes[index]);
+        remove(index);
+        for (const Entity entity : entities) _entityPool.destroy(entity); // Kill the entities
+    }
+
+    void TransformPool::remove(const size_t index) {
+        const size_t count = _subtreeSizes[index];
+        for (Entity ancestor = _parents[index]; ancestor != EntityPool::NULL_ENTITY; ancestor = _parents[_set.index(ancestor)]) {
+            _subtreeSizes[_set.index(ancestor)] -= count;
+        }
+
+        const size_t last = _set.size() - 1;
+        if (count == 1 && _parents[index] == EntityPool::NULL_ENTITY &&
+            _parents[last] == EntityPool::NULL_ENTITY && _subtreeSizes[last] == 1
+        ) {
+            // Moving a root without children over another keeps the order valid, so swap like other pools
+            if (index != last) {
+                _positions[index] = _positions[last];
+                _rotations[index] = _rotations[last];
+                _scales[index] = _scales[last];
+                _velocities[index] = _velocities[last];
+                _accelerations[index] = _accelerations[last];
+                _worldPositions[index] = _worldPositions[last];
+                _worldRotations[index] = _worldRotations[last];
+                _worldScales[index] = _worldScales[last];
+
+                // Carry the dirty bit over with the moved transform
+                _dirty[index / 64] &= ~(static_cast<uint64_t>(1) << (index % 64));
+                _dirty[index / 64] |= static_cast<uint64_t>(dirtyAt(last)) << (index % 64);
+            }
+            _set.removeAt(index);
+            popBack();
+            return;
+        }
+
+        // Otherwise move the subtree to the end, shifting everything after it back
+        rotate(index, index + count, last + 1);
+        for (size_t i = 0; i < count; i++) {
+            _set.removeAt(_set.size() - 1);
+            popBack();
+        }
+        _hierarchyChanged = true;
+    }
+
+    void TransformPool::popBack() {
+        const size_t last = _positions.size() - 1;
+        _dirty[last / 64] &= ~(static_cast<uint64_t>(1) << (last % 64));
+        if (last % 64 == 0) _dirty.pop_back();
+
+        _positions.pop_back();
+        _rotations.pop_back();
+        _scales.pop_back();
+        _velocities.pop_back();
+        _accelerations.pop_back();
+        _worldPositions.pop_back();
+        _worldRotations.pop_back();
+        _worldScales.pop_back();
+        _parents.pop_back();
+        _parentIndices.pop_back();
+        _subtreeSizes.pop_back();
+    }
+
+    void TransformPool::rotate(const size_t first, const size_t middle, const size_t last) {
+        auto rotateArray = [&](auto& values) {
+            std::rotate(values.begin() + first, values.begin() + middle, values.begin() + last);
+        };
+        rotateArray(_positions);
+        rotateArray(_rotations);
+        rotateArray(_scales);
+        rotateArray(_velocities);
+        rotateArray(_accelerations);
+        rotateArray(_worldPositions);
+        rotateArray(_worldRotations);
+        rotateArray(_worldScales);
+        rotateArray(_parents);
+        rotateArray(_subtreeSizes);
+        _set.rotate(first, middle, last);
+
+        std::vector<bool> dirty(last - first);
+        for (size_t i = first; i < last; i++) dirty[i - first] = dirtyAt(i);
+        std::rotate(dirty.begin(), dirty.begin() + (middle - first), dirty.end());
+        for (size_t i = first; i < last; i++) {
+            _dirty[i / 64] &= ~(static_cast<uint64_t>(1) << (i % 64));
+            _dirty[i / 64] |= static_cast<uint64_t>(dirty[i - first]) << (i % 64);
+        }
+    }
+
+    bool TransformPool::setParent(const Entity entity, const Entity parent) {
+        const size_t index = _set.index(entity);
+        const size_t count = _subtreeSizes[index];
+        if (parent != EntityPool::NULL_ENTITY) {
+            const size_t parentIndex = _set.index(parent);
+            if (parentIndex == SparseSet::NULL_INDEX || (parentIndex >= index && parentIndex < index + count)) return false;
+        }
+
+        // Detach the subtree and move it to the end
+        for (Entity ancestor = _parents[index]; ancestor != EntityPool::NULL_ENTITY; ancestor = _parents[_set.index(ancestor)]) {
+            _subtreeSizes[_set.index(ancestor)] -= count;
+        }
+        const size_t size = _set.size();
+        rotate(index, index + count, size);
+        _parents[size - count] = parent;
+
+        // Then move it to the end of the new parent's subtree
+        if (parent != EntityPool::NULL_ENTITY) {
+            const size_t parentIndex = _set.index(parent);
+            rotate(parentIndex + _subtreeSizes[parentIndex], size - count, size);
+            for (Entity ancestor = parent; ancestor != EntityPool::NULL_ENTITY; ancestor = _parents[_set.index(ancestor)]) {
+                _subtreeSizes[_set.index(ancestor)] += count;
+            }
+        }
+
+        markDirty(_set.index(entity));
+        _hierarchyChanged = true;
+        return true;
+    }
+
+    void TransformPool::propagate() {
+        const size_t count = _set.size();
+        if (_hierarchyChanged) {
+            for (size_t i = 0; i < count; i++) {
+                _parentIndices[i] = _parents[i] == EntityPool::NULL_ENTITY ?
+                    SparseSet::NULL_INDEX : static_cast<uint32_t>(_set.index(_parents[i]));
+            }
+            _hierarchyChanged = false;
+        }
+
+        // Parents come first, so their world transforms are final by the time their children are reached
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t parent = _parentIndices[i];
+            if (parent == SparseSet::NULL_INDEX) {
+                if (!dirtyAt(i)) continue;
+                _worldPositions[i] = _positions[i];
+                _worldRotations[i] = _rotations[i];
+                _worldScales[i] = _scales[i];
+                continue;
+            }
+
+            if (!dirtyAt(i) && !dirtyAt(parent)) continue;
+            compose(&_worldPositions[parent], &_worldRotations[parent], &_worldScales[parent],
+                &_positions[i], &_rotations[i], &_scales[i],
+                &_worldPositions[i], &_worldRotations[i], &_worldScales[i], 1
+            );
+            markDirty(i);
+        }
+    }
+
+    void TransformPool::setTransform(const Entity entity, const WorldTransform& transform) {
+        const size_t i = _set.index(entity);
+        _positions[i] = transform.position;
+        _rotations[i] = transform.rotation;
+        _scales[i] = transform.scale;
+        markDirty(i);
+    }
+
+    void TransformPool::clearDirty() {
+        std::fill(_dirty.begin(), _dirty.end(), 0);
+    }
+
+    bool TransformPool::anyDirty() const {
+        return std::any_of(_dirty.begin(), _dirty.end(), [](const uint64_t word) { return word != 0; });
+    }
+
+    void TransformPool::integrate(const float64_t dt) {
+        Jobs::parallelFor(size(), INTEGRATE_GRAIN, [&](const size_t begin, const size_t end) {
+            integrate(
+                reinterpret_cast<float64_t*>(_positions.data() + begin),
+                reinterpret_cast<float64_t*>(_velocities.data() + begin),
+                reinterpret_cast<const float64_t*>(_accelerations.data() + begin),
+                (end - begin) * 3, dt
+            );
+
+            // Mark moving transforms, a whole dirty word at a time
+            for (size_t word = begin / 64; word * 64 < end; word++) {
+                uint64_t moved = 0;
+                const size_t wordEnd = std::min(word * 64 + 64, end);
+                for (size_t i = word * 64; i < wordEnd; i++) {
+                    const glm::dvec3& v = _velocities[i];
+                    moved |= static_cast<uint64_t>(v.x != 0. || v.y != 0. || v.z != 0.) << (i % 64);
+                }
+                _dirty[word] |= moved;
+            }
+        });
+    }
+
+    void TransformPool::integrate(float64_t*__restrict__ positions, float64_t*__restrict__ velocities,
+        const float64_t*__restrict__ accelerations, const size_t count, const float64_t dt
+    ) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float64x4_t p, v, a;
+            std::memcpy(&p, positions + i, sizeof(p));
+            std::memcpy(&v, velocities + i, sizeof(v));
+            std::memcpy(&a, accelerations + i, sizeof(a));
+
+            v += a * dt;
+            p += v * dt;
+
+            std::memcpy(velocities + i, &v, sizeof(v));
+            std::memcpy(positions + i, &p, sizeof(p));
+        }
+
+        for (; i < count; i++) {
+            velocities[i] += accelerations[i] * dt;
+            positions[i] += velocities[i] * dt;
+        }
+    }
+
+    void TransformPool::compose(const glm::dvec3*__restrict__ parentPositions, const glm::dquat*__restrict__ parentRotations,
+        const glm::dvec3*__restrict__ parentScales, const glm::dvec3*__restrict__ localPositions,
+        const glm::dquat*__restrict__ localRotations, const glm::dvec3*__restrict__ localScales,
+        glm::dvec3*__restrict__ positions, glm::dquat*__restrict__ rotations, glm::dvec3*__restrict__ scales,
+        const size_t count
+    ) {
+        for (size_t i = 0; i < count; i++) {
+            positions[i] = parentPositions[i] + parentRotations[i] * (parentScales[i] * localPositions[i]);
+            rotations[i] = parentRotations[i] * localRotations[i];
+            scales[i] = parentScales[i] * localScales[i];
+        }
     }
 }
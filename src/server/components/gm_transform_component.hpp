@@ -1,85 +1,161 @@
 #pragma once
 
+#include <common/headers/float.hpp>
 #include <server/entities/gm_entity.hpp>
+#include <server/entities/gm_sparse_set.hpp>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
-#include <algorithm>
-#include <string>
+#include <cstdint>
 #include <vector>
-#include <unordered_map>
 
 namespace game {
     // Types
     struct WorldTransform {
         glm::dvec3 position{};
         glm::dvec3 scale{1., 1., 1.};
-        glm::dquat rotation{0., 0., 0., 1.};
+        glm::dquat rotation{1., 0., 0., 0.}; // Identity, in glm's (w, x, y, z) order
         bool dirty; // True if the transform has changed this frame and must be recalculated for rendering
     };
 
-    class TransformComponent {
+    // Transforms stored as separate position, rotation and scale arrays, with the velocity and acceleration used to
+    // integrate positions alongside them. Batch updates stream through the arrays instead of striding over whole
+    // transforms, and a bitset records which transforms changed since the last clearDirty().
+    //
+    // Transforms form a hierarchy kept in pre-order: every parent comes before its children, and the descendants of the
+    // transform at index i are exactly [i + 1, i + subtreeSize(i)). Position, rotation and scale are local to the
+    // parent, and propagate() turns them into world transforms in a single pass. Root transforms are their own world
+    // transforms.
+    class TransformPool {
         public:
             // Constructors
-            TransformComponent(const Entity entity) : _entity{entity} {}
+            TransformPool(EntityPool& entityPool, const size_t initialCapacity);
 
             // Functions
-            Entity entity() const { return _entity; }
-            Entity parent() const { return _parent; }
-            std::vector<Entity> children() const { return _children; }
-
-            void setParent(const Entity parent) { _parent = parent; }
-            void addChild(const Entity child) { _children.push_back(child); }
-            void removeChild(const Entity child) { _children.erase(std::find(_children.begin(), _children.end(), child)); }
-            void removeFirstChild() { _children.erase(_children.begin()); }
-            void removeLastChild() { _children.erase(_children.end()); }
-
-            void setTransform(const WorldTransform& transform) { _transform = transform; _transform.dirty = true; }
-            void setPosition(const glm::dvec3& position) { _transform.position = position; _transform.dirty = true; }
-            void setScale(const glm::dvec3& scale) { _transform.scale = scale; _transform.dirty = true; }
-            void setRotation(const glm::dquat& rotation) { _transform.rotation = rotation; _transform.dirty = true; }
-
-            WorldTransform transform() const { return _transform; }
-            glm::dvec3 position() const { return _transform.position; }
-            glm::dvec3 scale() const { return _transform.scale; }
-            glm::dquat rotation() const { return _transform.rotation; }
-            bool dirty() const { return _transform.dirty; }
+            // @return The index of the new transform
+            size_t create(const Entity entity) { return create(entity, origin); }
+            size_t create(const Entity entity, const WorldTransform& transform);
+            // Removes the transform at @p index and its descendants, and kills their entities.
+            void destroy(const size_t index);
+            // Removes the transform at @p index and its descendants, leaving their entities alive.
+            // Root transforms without children are replaced by the last transform, others shift the transforms after them.
+            void remove(const size_t index);
+
+            bool contains(const Entity entity) const { return _set.contains(entity); }
+            size_t indexOf(const Entity entity) const { return _set.index(entity); }
+            Entity entity(const size_t index) const { return _set.entity(index); }
+            size_t size() const { return _set.size(); }
+
+            WorldTransform transform(const Entity entity) const {
+                const size_t i = _set.index(entity);
+                return WorldTransform{_positions[i], _scales[i], _rotations[i], dirtyAt(i)};
+            }
+            glm::dvec3 position(const Entity entity) const { return _positions[_set.index(entity)]; }
+            glm::dvec3 scale(const Entity entity) const { return _scales[_set.index(entity)]; }
+            glm::dquat rotation(const Entity entity) const { return _rotations[_set.index(entity)]; }
+            glm::dvec3 velocity(const Entity entity) const { return _velocities[_set.index(entity)]; }
+            glm::dvec3 acceleration(const Entity entity) const { return _accelerations[_set.index(entity)]; }
+            bool dirty(const Entity entity) const { return dirtyAt(_set.index(entity)); }
+
+            WorldTransform worldTransform(const Entity entity) const {
+                const size_t i = _set.index(entity);
+                return WorldTransform{_worldPositions[i], _worldScales[i], _worldRotations[i], dirtyAt(i)};
+            }
+            glm::dvec3 worldPosition(const Entity entity) const { return _worldPositions[_set.index(entity)]; }
+            glm::dvec3 worldScale(const Entity entity) const { return _worldScales[_set.index(entity)]; }
+            glm::dquat worldRotation(const Entity entity) const { return _worldRotations[_set.index(entity)]; }
+
+            void setTransform(const Entity entity, const WorldTransform& transform);
+            void setPosition(const Entity entity, const glm::dvec3& position) { set(_positions, entity, position); }
+            void setScale(const Entity entity, const glm::dvec3& scale) { set(_scales, entity, scale); }
+            void setRotation(const Entity entity, const glm::dquat& rotation) { set(_rotations, entity, rotation); }
+            void setVelocity(const Entity entity, const glm::dvec3& velocity) { _velocities[_set.index(entity)] = velocity; }
+            void setAcceleration(const Entity entity, const glm::dvec3& acceleration) {
+                _accelerations[_set.index(entity)] = acceleration;
+            }
+
+            // Makes @p entity's transform a child of @p parent's, or a root if @p parent is NULL_ENTITY. The local transform
+            // is kept, so it is now relative to @p parent. The subtree of @p entity moves to the end of @p parent's.
+            // @return False if @p parent has no transform, or is @p entity or one of its descendants
+            bool setParent(const Entity entity, const Entity parent);
+            Entity parent(const Entity entity) const { return _parents[_set.index(entity)]; }
+            size_t subtreeSize(const size_t index) const { return _subtreeSizes[index]; }
+
+            // Updates world transforms from parents to children. Only transforms that are dirty or have a parent whose
+            // world transform changed are recomputed, and those are marked dirty.
+            void propagate();
+
+            bool dirtyAt(const size_t index) const { return (_dirty[index / 64] >> (index % 64)) & 1; }
+            void markDirty(const size_t index) { _dirty[index / 64] |= static_cast<uint64_t>(1) << (index % 64); }
+            void clearDirty();
+            // @return True if any transform is dirty
+            bool anyDirty() const;
+            // @return The dirty bits of transforms [64 * @p word, 64 * @p word + 64)
+            uint64_t dirtyWord(const size_t word) const { return _dirty[word]; }
+
+            // Dense arrays, indexed by transform index
+            const glm::dvec3* worldPositions() const { return _worldPositions.data(); }
+            const glm::dquat* worldRotations() const { return _worldRotations.data(); }
+            const glm::dvec3* worldScales() const { return _worldScales.data(); }
+            glm::dvec3* positions() { return _positions.data(); }
+            glm::dquat* rotations() { return _rotations.data(); }
+            glm::dvec3* scales() { return _scales.data(); }
+            glm::dvec3* velocities() { return _velocities.data(); }
+            glm::dvec3* accelerations() { return _accelerations.data(); }
+
+            // Advances every transform by @p dt seconds of its velocity and acceleration, spread over Jobs.
+            // Transforms that moved are marked dirty.
+            void integrate(const float64_t dt);
+
+            // Semi-implicit Euler over @p count interleaved components: velocity += acceleration * dt, then
+            // position += velocity * dt, four components per SIMD operation.
+            static void integrate(float64_t*__restrict__ positions, float64_t*__restrict__ velocities,
+                const float64_t*__restrict__ accelerations, const size_t count, const float64_t dt);
+            // World transforms from local transforms and their parents' world transforms, for @p count transforms:
+            // position = parentPosition + parentRotation * (parentScale * localPosition), rotation = parentRotation
+            // * localRotation and scale = parentScale * localScale.
+            static void compose(const glm::dvec3*__restrict__ parentPositions, const glm::dquat*__restrict__ parentRotations,
+                const glm::dvec3*__restrict__ parentScales, const glm::dvec3*__restrict__ localPositions,
+                const glm::dquat*__restrict__ localRotations, const glm::dvec3*__restrict__ localScales,
+                glm::dvec3*__restrict__ positions, glm::dquat*__restrict__ rotations, glm::dvec3*__restrict__ scales,
+                const size_t count);
 
             // Variables
             static constexpr WorldTransform origin{};
-        
-        private:
-            // Variables
-            Entity _entity;
-
-            Entity _parent;
-            std::vector<Entity> _children;
-            
-            WorldTransform _transform{};
-            WorldTransform _speedTransform{};
-            WorldTransform _accelerationTransform{};
-    };
-
-    class TransformPool {
-        public:
-            // Constructors
-            TransformPool(EntityPool& entityPool, size_t initialCapacity) : _entityPool{entityPool}, _initialCapacity{initialCapacity} {}
+            static constexpr size_t INTEGRATE_GRAIN = 1024; // Transforms per job, a multiple of 64 so jobs never share a dirty word
 
+        private:
             // Functions
-            void create(const Entity entity);
-            void destroy(const size_t index);
-            TransformComponent& get(const Entity entity) { return _pool[_indexMap[entity]]; }
-            size_t size() const { return _size; };
+            template<typename T>
+            void set(std::vector<T>& values, const Entity entity, const T& value) {
+                const size_t i = _set.index(entity);
+                values[i] = value;
+                markDirty(i);
+            }
+
+            // Rotates every array over [@p first, @p last) like std::rotate, so @p middle becomes @p first.
+            void rotate(const size_t first, const size_t middle, const size_t last);
+            void popBack();
 
-        private:
             // Variables
             EntityPool& _entityPool;
-            size_t _initialCapacity;
-            std::unordered_map<Entity, size_t> _indexMap;
-            std::vector<TransformComponent> _pool{_initialCapacity};
-            size_t _size = 0;
+            SparseSet _set;
+            std::vector<glm::dvec3> _positions;
+            std::vector<glm::dquat> _rotations;
+            std::vector<glm::dvec3> _scales;
+            std::vector<glm::dvec3> _velocities;
+            std::vector<glm::dvec3> _accelerations;
+            std::vector<uint64_t> _dirty; // One bit per transform
+
+            std::vector<glm::dvec3> _worldPositions;
+            std::vector<glm::dquat> _worldRotations;
+            std::vector<glm::dvec3> _worldScales;
+            std::vector<Entity> _parents;
+            std::vector<uint32_t> _parentIndices; // Rebuilt from _parents by propagate() after the hierarchy changes
+            std::vector<uint32_t> _subtreeSizes; // Including the transform itself
+            bool _hierarchyChanged = false;
     };
 }
@@ -0,0 +1,25 @@
+#include "gm_component_types.hpp"
+
+#include <common/data/file/gm_logger.hpp>
+#include <common/headers/string.hpp>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace game {
+    // Names of the component types with an ID, shared by every module that asks for one
+    static std::mutex typesMtx_;
+    static std::unordered_map<std::string, ComponentID> typeIds_;
+
+    ComponentID ComponentTypes::add(const char*__restrict__ name) {
+        std::lock_guard lock(typesMtx_);
+        const auto [found, added] = typeIds_.try_emplace(name, static_cast<ComponentID>(typeIds_.size()));
+        if (added && found->second >= MAX_COMPONENTS) {
+            UTF8Str msg = FormatString::formatString("Too many component types, the limit is %u.", MAX_COMPONENTS);
+            Logger::crash(msg);
+        }
+
+        return found->second;
+    }
+}
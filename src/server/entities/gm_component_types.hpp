@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+
+namespace game {
+    typedef uint32_t ComponentID;
+    typedef uint64_t ComponentMask; // Bit N is set if the component with ID N is present
+
+    // Small IDs for component types, so sets of them fit in a mask, such as the access masks of scheduled systems.
+    class ComponentTypes {
+        public:
+            // Functions
+            // IDs are assigned on first use, in the order component types are first seen. Each module caches the ID
+            // of a type itself, but gets it from one registry by type name, so the server and client agree on it.
+            template<typename T>
+            static ComponentID id() {
+                static const ComponentID id = add(typeid(T).name());
+                return id;
+            }
+
+            template<typename... Ts>
+            static ComponentMask mask() { return ((static_cast<ComponentMask>(1) << id<std::decay_t<Ts>>()) | ... | 0); }
+
+            // Variables
+            static constexpr uint32_t MAX_COMPONENTS = 64;
+
+        private:
+            // Functions
+            // @return The ID of the type named @p name, assigned if it has none yet
+            static ComponentID add(const char*__restrict__ name);
+    };
+}
@@ -1,32 +1,62 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <unordered_set>
+#include <vector>
 
 namespace game {
-    typedef size_t Entity;
+    // Entities pack an index into the low 32 bits and a generation into the high 32 bits. The generation is bumped
+    // whenever an index is destroyed, so handles to destroyed entities are never alive again even if the index is reused.
+    typedef uint64_t Entity;
 
     class EntityPool {
         public:
             // Functions
             Entity create() {
-                // Recycle ID if ID loops
-                while (alive(++_next));
-                _entities.insert(_next);
-                return _next;
+                uint32_t index;
+                if (_free.empty()) {
+                    index = static_cast<uint32_t>(_generations.size());
+                    _generations.push_back(0);
+                } else {
+                    index = _free.back();
+                    _free.pop_back();
+                }
+
+                return makeEntity(index, _generations[index]);
             }
 
-            bool alive(Entity entity) {
-                return _entities.contains(entity);
+            bool alive(const Entity entity) const {
+                const uint32_t index = entityIndex(entity);
+                return index < _generations.size() && _generations[index] == entityGeneration(entity);
             }
 
-            void destroy(Entity entity) {
-                _entities.erase(entity);
+            void destroy(const Entity entity) {
+                if (!alive(entity)) return;
+
+                // Retire indices whose generation would wrap, so old handles can never match again
+                const uint32_t index = entityIndex(entity);
+                if (++_generations[index] != UINT32_MAX) _free.push_back(index);
+                else _retired++;
             }
 
+            // Number of living entities
+            size_t size() const { return _generations.size() - _free.size() - _retired; }
+            // One past the highest index ever created, for sizing arrays indexed by entityIndex()
+            size_t capacity() const { return _generations.size(); }
+
+            static constexpr uint32_t entityIndex(const Entity entity) { return static_cast<uint32_t>(entity); }
+            static constexpr uint32_t entityGeneration(const Entity entity) { return static_cast<uint32_t>(entity >> 32); }
+            static constexpr Entity makeEntity(const uint32_t index, const uint32_t generation) {
+                return (static_cast<Entity>(generation) << 32) | index;
+            }
+
+            // Variables
+            static constexpr Entity NULL_ENTITY = UINT64_MAX; // Never alive
+
         private:
             // Variables
-            std::unordered_set<Entity> _entities;
-            Entity _next;
+            std::vector<uint32_t> _generations; // Current generation of every index
+            std::vector<uint32_t> _free; // Destroyed indices, reused most recent first
+            size_t _retired = 0; // Destroyed indices never reused, since their generation ran out
     };
 }
@@ -0,0 +1,52 @@
+#include "gm_entity_commands.hpp"
+
+#include <common/system/gm_jobs.hpp>
+
+namespace game {
+    void EntityCommands::begin() {
+        const size_t count = Jobs::workerCount() + 1;
+        if (_buffers.size() != count) _buffers.resize(count);
+    }
+
+    EntityCommands::Buffer& EntityCommands::buffer() {
+        const int32_t worker = Jobs::workerIndex();
+        return _buffers[worker >= 0 ? worker : _buffers.size() - 1];
+    }
+
+    void EntityCommands::destroy(const Entity entity) {
+        if (Jobs::workerIndex() < 0) {
+            std::lock_guard lock(_sharedMtx);
+            buffer().destroyed.push_back(entity);
+            return;
+        }
+        buffer().destroyed.push_back(entity);
+    }
+
+    void EntityCommands::create(std::function<void(const Entity entity)>&& init) {
+        if (Jobs::workerIndex() < 0) {
+            std::lock_guard lock(_sharedMtx);
+            buffer().created.push_back(std::move(init));
+            return;
+        }
+        buffer().created.push_back(std::move(init));
+    }
+
+    void EntityCommands::apply(EntityPool& entityPool, const std::function<void(const Entity entity)>& onDestroy) {
+        for (Buffer& buffer : _buffers) {
+            // Initialisers may record more commands, which wait for the next apply()
+            std::vector<std::function<void(const Entity entity)>> created;
+            created.swap(buffer.created);
+            for (const std::function<void(const Entity entity)>& init : created) init(entityPool.create());
+        }
+
+        for (Buffer& buffer : _buffers) {
+            for (const Entity entity : buffer.destroyed) {
+                // The same entity may have been recorded by several components
+                if (!entityPool.alive(entity)) continue;
+                onDestroy(entity);
+                entityPool.destroy(entity);
+            }
+            buffer.destroyed.clear();
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "gm_entity.hpp"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace game {
+    // Records entity creation and destruction requested while pools are updated in parallel, to be applied once the
+    // pass is over. Each job worker records into its own buffer, so recording takes no lock.
+    class EntityCommands {
+        public:
+            // Constructors
+            EntityCommands() { begin(); }
+
+            EntityCommands(const EntityCommands &) = delete;
+            EntityCommands &operator=(const EntityCommands &) = delete;
+
+            // Functions
+            // Sizes the buffers for the current workers. Call before a pass, while nothing is recording.
+            void begin();
+
+            void destroy(const Entity entity);
+            // @p init is called with the new entity when the commands are applied.
+            void create(std::function<void(const Entity entity)>&& init);
+
+            // Creates, then destroys, every recorded entity in the order each thread recorded them. @p onDestroy is called
+            // for each entity still alive before it is killed, to remove its components.
+            void apply(EntityPool& entityPool, const std::function<void(const Entity entity)>& onDestroy);
+
+        private:
+            // Types
+            typedef struct alignas(64) Buffer_ { // Own cache line, so workers do not contend
+                std::vector<Entity> destroyed;
+                std::vector<std::function<void(const Entity entity)>> created;
+            } Buffer;
+
+            // Functions
+            Buffer& buffer();
+
+            // Variables
+            std::vector<Buffer> _buffers; // One per worker, then one shared by other threads
+            std::mutex _sharedMtx;
+    };
+}
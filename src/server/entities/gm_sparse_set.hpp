@@ -0,0 +1,95 @@
+#pragma once
+
+#include "gm_entity.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace game {
+    // Maps entities to indices in a dense array, so lookups are two array loads and iteration stays packed.
+    // The sparse side is split into pages by entity index, and only pages holding an entity are allocated.
+    class SparseSet {
+        public:
+            // Functions
+            bool contains(const Entity entity) const {
+                const uint32_t index = denseIndex(EntityPool::entityIndex(entity));
+                return index != NULL_INDEX && _dense[index] == entity;
+            }
+
+            // @return The dense index of @p entity, or NULL_INDEX if it is not in the set
+            size_t index(const Entity entity) const {
+                const uint32_t index = denseIndex(EntityPool::entityIndex(entity));
+                return (index != NULL_INDEX && _dense[index] == entity) ? index : NULL_INDEX;
+            }
+
+            // Appends @p entity, which must not already be in the set.
+            // @return The dense index of @p entity
+            size_t insert(const Entity entity) {
+                const uint32_t entityIndex = EntityPool::entityIndex(entity);
+                const size_t page = entityIndex / PAGE_SIZE;
+                if (page >= _pages.size()) _pages.resize(page + 1);
+                if (!_pages[page]) {
+                    _pages[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+                    std::fill_n(_pages[page].get(), PAGE_SIZE, NULL_INDEX);
+                }
+
+                _pages[page][entityIndex % PAGE_SIZE] = static_cast<uint32_t>(_dense.size());
+                _dense.push_back(entity);
+                return _dense.size() - 1;
+            }
+
+            // Removes the entity at dense @p index by moving the last entity into its place.
+            // Callers keeping data parallel to the set must move their last element to @p index as well.
+            void removeAt(const size_t index) {
+                const Entity removed = _dense[index];
+                const Entity last = _dense.back();
+
+                _dense[index] = last;
+                _pages[EntityPool::entityIndex(last) / PAGE_SIZE][EntityPool::entityIndex(last) % PAGE_SIZE] =
+                    static_cast<uint32_t>(index);
+                _pages[EntityPool::entityIndex(removed) / PAGE_SIZE][EntityPool::entityIndex(removed) % PAGE_SIZE] =
+                    NULL_INDEX;
+                _dense.pop_back();
+            }
+
+            // Rotates dense indices [@p first, @p last) like std::rotate, so @p middle becomes @p first.
+            // Callers keeping data parallel to the set must rotate it the same way.
+            void rotate(const size_t first, const size_t middle, const size_t last) {
+                std::rotate(_dense.begin() + first, _dense.begin() + middle, _dense.begin() + last);
+                for (size_t i = first; i < last; i++) {
+                    const uint32_t entityIndex = EntityPool::entityIndex(_dense[i]);
+                    _pages[entityIndex / PAGE_SIZE][entityIndex % PAGE_SIZE] = static_cast<uint32_t>(i);
+                }
+            }
+
+            void reserve(const size_t capacity) { _dense.reserve(capacity); }
+            void clear() {
+                _pages.clear();
+                _dense.clear();
+            }
+
+            size_t size() const { return _dense.size(); }
+            bool empty() const { return _dense.empty(); }
+            Entity entity(const size_t index) const { return _dense[index]; }
+            const std::vector<Entity>& entities() const { return _dense; }
+
+            // Variables
+            static constexpr uint32_t NULL_INDEX = UINT32_MAX;
+            static constexpr size_t PAGE_SIZE = 4096; // Entity indices per page
+
+        private:
+            // Functions
+            uint32_t denseIndex(const uint32_t entityIndex) const {
+                const size_t page = entityIndex / PAGE_SIZE;
+                if (page >= _pages.size() || !_pages[page]) return NULL_INDEX;
+                return _pages[page][entityIndex % PAGE_SIZE];
+            }
+
+            // Variables
+            std::vector<std::unique_ptr<uint32_t[]>> _pages; // Dense index of each entity index, or NULL_INDEX
+            std::vector<Entity> _dense;
+    };
+}
@@ -1,5 +1,7 @@
 #include "gm_server.hpp"
 
+#include <common/system/gm_profiler.hpp>
+
 namespace game {
     Server::Server() {
 
@@ -14,6 +16,7 @@ namespace game {
     }
 
     void Server::update() {
+        PROFILE_ZONE("Server::update");
         _world.update();
 
         // TODO Send data
@@ -1,9 +1,11 @@
 #include "gm_server_instance.hpp"
 
 #include <common/gm_core.hpp>
-#include <common/headers/float.hpp>
 #include <common/data/file/gm_logger.hpp>
+#include <common/data/string/gm_format_string.hpp>
+#include <common/system/gm_profiler.hpp>
 #include <common/system/gm_threads.hpp>
+#include <common/system/gm_tick_clock.hpp>
 
 namespace game {
     ServerInstance& ServerInstance::instance() {
@@ -26,22 +28,31 @@ namespace game {
         // TODO Open on port
 
         // Main game loop
-        auto previousTime = std::chrono::high_resolution_clock::now();
-        float128_t lag = 0.0f;
+        TickClock clock{std::chrono::milliseconds(Core::MS_PER_TICK)};
+        uint64_t nextStatsTick = 0;
         while (Core::running) {
-            auto currentTime = std::chrono::high_resolution_clock::now();
-            float128_t elapsedTime = std::chrono::duration<float128_t, std::chrono::milliseconds::period>(currentTime - previousTime).count();
-            previousTime = currentTime;
-            lag += elapsedTime;
-
-            // Prioritize game update when behind, skip to rendering when ahead
-            while (lag >= Core::MS_PER_TICK) {
+            // Catch up on every tick that is due
+            while (clock.tick()) {
+                const uint64_t start = Profiler::timestamp();
                 _server.update();
-                lag -= Core::MS_PER_TICK;
+
+                // Report where the time went, at most once per interval so a struggling server does not flood the log
+                const float64_t ms = Profiler::milliseconds(Profiler::timestamp() - start);
+                if (ms > Core::MS_PER_TICK) {
+                    UTF8Str msg = FormatString::formatString("Tick %lu took %.1fms.", clock.ticks(), ms);
+                    Logger::log(LOG_WARN, msg);
+                    if (clock.ticks() >= nextStatsTick) {
+                        Profiler::logStats();
+                        nextStatsTick = clock.ticks() + OVERRUN_STATS_INTERVAL;
+                    }
+                }
             }
 
             // Send data
             // TODO Send/receive data
+
+            // Nothing to render, so give the core back until the next tick
+            clock.sleep();
         }
 
         Core::running = false;
@@ -23,6 +23,8 @@ namespace game {
             ~ServerInstance();
 
             // Variables
+            static constexpr uint64_t OVERRUN_STATS_INTERVAL = 60 * 20; // One minute of ticks between profile stats logged on overruns
+
             Server _server;
     };
 }
\ No newline at end of file
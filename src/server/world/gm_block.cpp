@@ -0,0 +1,23 @@
+#include "gm_block.hpp"
+
+#include <common/data/file/gm_logger.hpp>
+
+namespace game {
+    // In ID order
+    std::vector<BlockInfo> Blocks::_blocks = {
+        BlockInfo{"air", false, 0, 0},
+        BlockInfo{"stone", true, 15, 0},
+        BlockInfo{"dirt", true, 15, 0},
+        BlockInfo{"grass", true, 15, 0},
+        BlockInfo{"sand", true, 15, 0},
+        BlockInfo{"water", false, 2, 0},
+        BlockInfo{"bedrock", true, 15, 0},
+    };
+
+    BlockID Blocks::add(const BlockInfo& info) {
+        if (_blocks.size() > UINT16_MAX) Logger::crash("Too many block types.");
+
+        _blocks.push_back(info);
+        return static_cast<BlockID>(_blocks.size() - 1);
+    }
+}
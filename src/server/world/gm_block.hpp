@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+    class World;
+
+    typedef uint16_t BlockID;
+
+    // Called with the world and the block's world coordinates
+    typedef void (*BlockTick)(World& world, const int32_t x, const int32_t y, const int32_t z);
+
+    typedef struct BlockInfo_ {
+        const char* name;
+        bool solid; // Blocks movement
+        uint8_t opacity; // Light lost passing through, on top of the 1 lost per block. 15 or more blocks light entirely.
+        uint8_t emission; // Block light given off, from 0 to 15
+        BlockTick tick = nullptr; // Runs when a tick scheduled with World::scheduleTick() for the block is due
+        BlockTick randomTick = nullptr; // Runs when the block is picked at random, if set, like grass spreading
+    } BlockInfo;
+
+    // Every kind of block, indexed by ID. Built-in blocks have fixed IDs, others are added at startup before any world
+    // is loaded, since IDs are stored in chunks.
+    class Blocks {
+        public:
+            // Functions
+            static BlockID add(const BlockInfo& info);
+            static const BlockInfo& info(const BlockID id) { return _blocks[id]; }
+            static size_t count() { return _blocks.size(); }
+
+            // Variables
+            static constexpr BlockID AIR = 0;
+            static constexpr BlockID STONE = 1;
+            static constexpr BlockID DIRT = 2;
+            static constexpr BlockID GRASS = 3;
+            static constexpr BlockID SAND = 4;
+            static constexpr BlockID WATER = 5;
+            static constexpr BlockID BEDROCK = 6;
+
+        private:
+            // Variables
+            static std::vector<BlockInfo> _blocks;
+    };
+}
@@ -0,0 +1,186 @@
+#include "gm_chunk.hpp"
+
+#include <common/headers/string.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace game {
+    static uint32_t randomTicks_(const BlockID block) {
+        return Blocks::info(block).randomTick != nullptr;
+    }
+
+    // ChunkSection //
+    ChunkSection::ChunkSection(std::vector<BlockID>&& palette, std::vector<uint64_t>&& data, const uint32_t bits) :
+        _palette{std::move(palette)}, _data{std::move(data)}, _bits{bits}
+    {
+        const bool validBits = bits == 0 || bits == 1 || bits == 2 || bits == 4 || bits == 8 || bits == DIRECT_BITS;
+        const bool validPalette = bits == DIRECT_BITS ? _palette.empty() :
+            !_palette.empty() && _palette.size() <= (static_cast<size_t>(1) << bits);
+        if (!validBits || !validPalette || _data.size() != VOLUME * bits / 64) {
+            UTF8Str msg = FormatString::formatString("Malformed chunk section: %u bits, %lu palette entries, %lu words.",
+                bits, _palette.size(), _data.size()
+            );
+            throw std::runtime_error(msg.get());
+        }
+
+        // Saved by a build with more blocks, or corrupt, and either way not something Blocks::info() can look up
+        for (const BlockID block : _palette) {
+            if (block >= Blocks::count()) {
+                UTF8Str msg = FormatString::formatString("Malformed chunk section: unknown block %u.", block);
+                throw std::runtime_error(msg.get());
+            }
+        }
+
+        for (uint32_t i = 0; i < VOLUME; i++) {
+            if (_bits != 0 && _bits != DIRECT_BITS && read(i) >= _palette.size()) {
+                throw std::runtime_error("Malformed chunk section: block index past the end of the palette.");
+            }
+            if (_bits == DIRECT_BITS && get(i) >= Blocks::count()) {
+                UTF8Str msg = FormatString::formatString("Malformed chunk section: unknown block %u.", get(i));
+                throw std::runtime_error(msg.get());
+            }
+            _nonAir += get(i) != Blocks::AIR;
+            _randomTicks += randomTicks_(get(i));
+        }
+    }
+
+    BlockID ChunkSection::set(const uint32_t index, const BlockID block) {
+        const BlockID previous = get(index);
+        if (previous == block) return previous;
+        _nonAir += (block != Blocks::AIR) - (previous != Blocks::AIR);
+        _randomTicks += randomTicks_(block) - randomTicks_(previous);
+
+        auto found = std::find(_palette.begin(), _palette.end(), block);
+        if (_bits != DIRECT_BITS && found == _palette.end()) {
+            if (_bits > 0 && _palette.size() < (static_cast<size_t>(1) << _bits)) {
+                found = _palette.insert(_palette.end(), block);
+            } else {
+                // Out of room in the palette, so rebuild it with the new block
+                repack(block);
+                found = std::find(_palette.begin(), _palette.end(), block);
+            }
+        }
+
+        write(index, _bits == DIRECT_BITS ? block : static_cast<uint32_t>(found - _palette.begin()));
+        return previous;
+    }
+
+    void ChunkSection::fill(const BlockID block) {
+        _palette.assign(1, block);
+        _data.clear();
+        _data.shrink_to_fit();
+        _bits = 0;
+        _nonAir = block == Blocks::AIR ? 0 : VOLUME;
+        _randomTicks = randomTicks_(block) * VOLUME;
+    }
+
+    ChunkSection::ChunkSection(const BlockID*__restrict__ blocks) {
+        // Runs of the same block are common, so only look up the palette when the block changes
+        std::vector<BlockID> palette{blocks[0]};
+        for (uint32_t i = 1; i < VOLUME && palette.size() <= 256; i++) {
+            if (blocks[i] != blocks[i - 1] && std::find(palette.begin(), palette.end(), blocks[i]) == palette.end()) {
+                palette.push_back(blocks[i]);
+            }
+        }
+
+        pack(blocks, std::move(palette));
+        for (uint32_t i = 0; i < VOLUME; i++) {
+            _nonAir += blocks[i] != Blocks::AIR;
+            _randomTicks += randomTicks_(blocks[i]);
+        }
+    }
+
+    void ChunkSection::repack(const BlockID block) {
+        std::array<BlockID, VOLUME> blocks;
+        for (uint32_t i = 0; i < VOLUME; i++) blocks[i] = get(i);
+
+        // Keep only the blocks still present, in order of first use
+        std::vector<BlockID> palette;
+        for (const BlockID used : blocks) {
+            if (std::find(palette.begin(), palette.end(), used) == palette.end()) palette.push_back(used);
+            if (palette.size() > 256) break;
+        }
+        if (std::find(palette.begin(), palette.end(), block) == palette.end()) palette.push_back(block);
+
+        pack(blocks.data(), std::move(palette));
+    }
+
+    void ChunkSection::pack(const BlockID*__restrict__ blocks, std::vector<BlockID>&& palette) {
+        _bits = bitsFor(palette.size());
+        _data.assign(VOLUME * _bits / 64, 0);
+        _data.shrink_to_fit();
+        if (_bits == DIRECT_BITS) {
+            _palette.clear();
+            _palette.shrink_to_fit();
+            for (uint32_t i = 0; i < VOLUME; i++) write(i, blocks[i]);
+            return;
+        }
+
+        _palette = std::move(palette);
+        if (_bits == 0) return;
+
+        uint32_t index = 0;
+        for (uint32_t i = 0; i < VOLUME; i++) {
+            if (i == 0 || blocks[i] != blocks[i - 1]) {
+                index = static_cast<uint32_t>(std::find(_palette.begin(), _palette.end(), blocks[i]) - _palette.begin());
+            }
+            write(i, index);
+        }
+    }
+
+    uint32_t ChunkSection::bitsFor(const size_t paletteSize) {
+        // Widths that divide 64, so no index spans two words
+        if (paletteSize <= 1) return 0;
+        if (paletteSize <= 2) return 1;
+        if (paletteSize <= 4) return 2;
+        if (paletteSize <= 16) return 4;
+        if (paletteSize <= 256) return 8;
+        return DIRECT_BITS;
+    }
+
+    // LightSection //
+    void LightSection::allocate(const uint32_t channel) {
+        const uint8_t fill = static_cast<uint8_t>(_fill[channel] | (_fill[channel] << 4));
+        _data[channel] = std::make_unique<uint8_t[]>(BYTES);
+        std::fill_n(_data[channel].get(), BYTES, fill);
+    }
+
+    size_t LightSection::memoryUsage() const {
+        size_t usage = sizeof(*this);
+        for (const std::unique_ptr<uint8_t[]>& data : _data) if (data) usage += BYTES;
+        return usage;
+    }
+
+    // Chunk //
+    BlockID Chunk::setBlock(const uint32_t x, const uint32_t y, const uint32_t z, const BlockID block) {
+        std::shared_ptr<ChunkSection>& section = _sections[y / ChunkSection::SIZE];
+        if (!section) {
+            if (block == Blocks::AIR) return Blocks::AIR;
+            section = std::make_shared<ChunkSection>();
+        } else if (section.use_count() > 1) {
+            // Shared with a snapshot, so write to a copy unless the block is already set
+            if (section->get(x, y % ChunkSection::SIZE, z) == block) return block;
+            section = std::make_shared<ChunkSection>(*section);
+        }
+
+        const BlockID previous = section->set(x, y % ChunkSection::SIZE, z, block);
+        if (previous != block) _dirty = true;
+        if (section->empty()) section.reset();
+        return previous;
+    }
+
+    size_t Chunk::memoryUsage() const {
+        size_t usage = sizeof(*this);
+        for (const std::shared_ptr<ChunkSection>& section : _sections) if (section) usage += section->memoryUsage();
+        for (const LightSection& light : _light) usage += light.memoryUsage();
+        return usage;
+    }
+
+    std::unique_ptr<Chunk> Chunk::snapshot() const {
+        std::unique_ptr<Chunk> copy = std::make_unique<Chunk>(_pos);
+        copy->_sections = _sections;
+        copy->_dirty = _dirty;
+        return copy;
+    }
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "gm_block.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace game {
+    typedef struct ChunkPos_ {
+        int32_t x;
+        int32_t z;
+
+        bool operator==(const ChunkPos_& other) const { return x == other.x && z == other.z; }
+
+        // @return The chunk holding the block at @p x, @p z
+        static ChunkPos_ fromBlock(const int32_t x, const int32_t z) { return ChunkPos_{x >> 4, z >> 4}; }
+    } ChunkPos;
+
+    struct ChunkPosHash {
+        size_t operator()(const ChunkPos& pos) const {
+            const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 32) | static_cast<uint32_t>(pos.z);
+            return static_cast<size_t>((key ^ (key >> 29)) * 0x9E3779B97F4A7C15ull); // Spread nearby chunks over buckets
+        }
+    };
+
+    // A 16x16x16 cube of blocks, stored as indices into a palette of the block IDs it contains.
+    // Indices are packed into 64-bit words at 1, 2, 4 or 8 bits each, just wide enough for the palette, and a section
+    // of a single block type stores no indices at all. Past 256 block types the palette is dropped and IDs are stored
+    // directly at 16 bits each.
+    class ChunkSection {
+        public:
+            // Constructors
+            ChunkSection() {}
+            // Restores a section from its palette(), data() and bits(). Throws std::runtime_error if they do not fit
+            // together, such as an index past the end of the palette.
+            ChunkSection(std::vector<BlockID>&& palette, std::vector<uint64_t>&& data, const uint32_t bits);
+            // Builds a section from VOLUME blocks in index() order, packing them once instead of block by block.
+            ChunkSection(const BlockID*__restrict__ blocks);
+
+            // Functions
+            BlockID get(const uint32_t x, const uint32_t y, const uint32_t z) const { return get(index(x, y, z)); }
+            BlockID get(const uint32_t index) const {
+                if (_bits == 0) return _palette[0];
+                const uint32_t value = read(index);
+                return _bits == DIRECT_BITS ? static_cast<BlockID>(value) : _palette[value];
+            }
+
+            // @return The block that was replaced
+            BlockID set(const uint32_t x, const uint32_t y, const uint32_t z, const BlockID block) {
+                return set(index(x, y, z), block);
+            }
+            BlockID set(const uint32_t index, const BlockID block);
+            void fill(const BlockID block);
+
+            // @return True if every block is air
+            bool empty() const { return _nonAir == 0; }
+            uint32_t nonAirCount() const { return _nonAir; }
+            // @return The number of blocks with a random tick, so sections without any can be skipped
+            uint32_t randomTickCount() const { return _randomTicks; }
+            uint32_t bits() const { return _bits; }
+            size_t paletteSize() const { return _palette.size(); }
+            const std::vector<BlockID>& palette() const { return _palette; }
+            const std::vector<uint64_t>& data() const { return _data; }
+            size_t memoryUsage() const {
+                return sizeof(*this) + _palette.capacity() * sizeof(BlockID) + _data.capacity() * sizeof(uint64_t);
+            }
+
+            // Blocks are ordered by y, then z, then x
+            static uint32_t index(const uint32_t x, const uint32_t y, const uint32_t z) { return (y << 8) | (z << 4) | x; }
+
+            // Variables
+            static constexpr uint32_t SIZE = 16;
+            static constexpr uint32_t VOLUME = SIZE * SIZE * SIZE;
+            static constexpr uint32_t DIRECT_BITS = 16;
+
+        private:
+            // Functions
+            uint32_t read(const uint32_t index) const {
+                const uint32_t perWord = 64 / _bits;
+                return static_cast<uint32_t>(_data[index / perWord] >> ((index % perWord) * _bits)) & ((1u << _bits) - 1);
+            }
+            void write(const uint32_t index, const uint32_t value) {
+                const uint32_t perWord = 64 / _bits;
+                const uint32_t shift = (index % perWord) * _bits;
+                uint64_t& word = _data[index / perWord];
+                word = (word & ~(static_cast<uint64_t>((1u << _bits) - 1) << shift)) | (static_cast<uint64_t>(value) << shift);
+            }
+
+            // Rebuilds the palette from the blocks still in use plus @p block, and repacks the indices to fit it.
+            void repack(const BlockID block);
+            // Packs @p blocks, in index() order, as indices into @p palette, which must hold every one of them.
+            void pack(const BlockID*__restrict__ blocks, std::vector<BlockID>&& palette);
+
+            static uint32_t bitsFor(const size_t paletteSize);
+
+            // Variables
+            std::vector<BlockID> _palette{Blocks::AIR};
+            std::vector<uint64_t> _data; // Packed palette indices, or block IDs when _bits is DIRECT_BITS
+            uint32_t _bits = 0;
+            uint32_t _nonAir = 0;
+            uint32_t _randomTicks = 0;
+    };
+
+    enum LIGHT_CHANNELS {
+        LIGHT_SKY,
+        LIGHT_BLOCK,
+        LIGHT_CHANNEL_COUNT
+    };
+
+    // The sky and block light of a section, at 4 bits per block in ChunkSection::index() order. A channel holding a
+    // single level is not allocated, so open sky and solid ground cost nothing.
+    class LightSection {
+        public:
+            // Constructors
+            LightSection() {}
+
+            LightSection(const LightSection &) = delete;
+            LightSection &operator=(const LightSection &) = delete;
+
+            // Functions
+            uint8_t get(const uint32_t channel, const uint32_t index) const {
+                const std::unique_ptr<uint8_t[]>& data = _data[channel];
+                return data ? (data[index >> 1] >> ((index & 1) << 2)) & 15 : _fill[channel];
+            }
+            void set(const uint32_t channel, const uint32_t index, const uint8_t level) {
+                std::unique_ptr<uint8_t[]>& data = _data[channel];
+                if (!data) {
+                    if (level == _fill[channel]) return;
+                    allocate(channel);
+                }
+
+                uint8_t& byte = data[index >> 1];
+                const uint32_t shift = (index & 1) << 2;
+                byte = static_cast<uint8_t>((byte & ~(15 << shift)) | (level << shift));
+            }
+            // Sets every block of @p channel to @p level, freeing its array.
+            void fill(const uint32_t channel, const uint8_t level) {
+                _data[channel].reset();
+                _fill[channel] = level;
+            }
+
+            // @return True if every block of @p channel has the same level, which is then get(@p channel, 0)
+            bool uniform(const uint32_t channel) const { return !_data[channel]; }
+            size_t memoryUsage() const;
+
+            // Variables
+            static constexpr uint32_t BYTES = ChunkSection::VOLUME / 2; // Per allocated channel
+
+        private:
+            // Functions
+            void allocate(const uint32_t channel);
+
+            // Variables
+            std::array<std::unique_ptr<uint8_t[]>, LIGHT_CHANNEL_COUNT> _data;
+            std::array<uint8_t, LIGHT_CHANNEL_COUNT> _fill{};
+    };
+
+    // A column of sections, from y = 0 to HEIGHT. Sections that are entirely air are not allocated.
+    // Sections are copy-on-write: snapshot() shares them with the copy, and whichever chunk is written to next copies
+    // the section first. Snapshots can be read on other threads while the original keeps changing, as long as they are
+    // released on the thread that writes to the chunk, which then knows no other thread still reads a section it owns.
+    // Light is kept beside the blocks, one LightSection per section. It is not saved or shared with snapshots, since
+    // LightEngine rebuilds it whenever a chunk is loaded.
+    class Chunk {
+        public:
+            // Constructors
+            Chunk(const ChunkPos pos) : _pos{pos} {}
+
+            Chunk(const Chunk &) = delete;
+            Chunk &operator=(const Chunk &) = delete;
+
+            // Functions
+            // Coordinates are within the chunk, with @p x and @p z in [0, 16) and @p y in [0, HEIGHT).
+            BlockID getBlock(const uint32_t x, const uint32_t y, const uint32_t z) const {
+                const ChunkSection* section = _sections[y / ChunkSection::SIZE].get();
+                return section ? section->get(x, y % ChunkSection::SIZE, z) : Blocks::AIR;
+            }
+            // @return The block that was replaced
+            BlockID setBlock(const uint32_t x, const uint32_t y, const uint32_t z, const BlockID block);
+
+            // Coordinates are within the chunk, like getBlock().
+            uint8_t light(const uint32_t channel, const uint32_t x, const uint32_t y, const uint32_t z) const {
+                return _light[y / ChunkSection::SIZE].get(channel, ChunkSection::index(x, y % ChunkSection::SIZE, z));
+            }
+            void setLight(const uint32_t channel, const uint32_t x, const uint32_t y, const uint32_t z, const uint8_t level) {
+                _light[y / ChunkSection::SIZE].set(channel, ChunkSection::index(x, y % ChunkSection::SIZE, z), level);
+            }
+            LightSection& lightSection(const uint32_t index) { return _light[index]; }
+            const LightSection& lightSection(const uint32_t index) const { return _light[index]; }
+
+            ChunkPos pos() const { return _pos; }
+            // @return The section at height @p index, or nullptr if it is all air
+            const ChunkSection* section(const uint32_t index) const { return _sections[index].get(); }
+            // Replaces the section at height @p index, or removes it if @p section is nullptr or empty.
+            void setSection(const uint32_t index, std::unique_ptr<ChunkSection>&& section) {
+                _sections[index] = section && !section->empty() ? std::move(section) : nullptr;
+                _dirty = true;
+            }
+            size_t memoryUsage() const;
+
+            // @return A copy of this chunk sharing its sections, which costs no more than copying the pointers
+            std::unique_ptr<Chunk> snapshot() const;
+
+            // True if the chunk changed since it was last saved. New chunks have never been saved.
+            bool dirty() const { return _dirty; }
+            void setDirty(const bool dirty) { _dirty = dirty; }
+
+            // Variables
+            static constexpr uint32_t SECTIONS = 16;
+            static constexpr uint32_t HEIGHT = SECTIONS * ChunkSection::SIZE;
+
+        private:
+            // Variables
+            ChunkPos _pos;
+            std::array<std::shared_ptr<ChunkSection>, SECTIONS> _sections;
+            std::array<LightSection, SECTIONS> _light;
+            bool _dirty = true;
+    };
+}
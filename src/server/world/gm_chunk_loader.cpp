@@ -0,0 +1,157 @@
+#include "gm_chunk_loader.hpp"
+
+#include "gm_chunk_serializer.hpp"
+#include "gm_light_engine.hpp"
+
+#include <common/data/file/gm_logger.hpp>
+#include <common/headers/string.hpp>
+#include <common/system/gm_profiler.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace game {
+    ChunkLoader::~ChunkLoader() {
+        for (const auto& [pos, request] : _requests) request->cancelled = true;
+        for (const auto& [pos, request] : _requests) if (request->job) Jobs::wait(request->job);
+        for (const JobHandle& job : _cancelled) Jobs::wait(job);
+    }
+
+    void ChunkLoader::request(const ChunkPos pos) {
+        std::shared_ptr<LoadRequest>& request = _requests[pos];
+        if (request) return;
+
+        request = std::make_shared<LoadRequest>();
+        request->pos = pos;
+        _queue.push(QueueEntry{distance(pos), pos});
+        _queued++;
+    }
+
+    void ChunkLoader::cancel(const ChunkPos pos) {
+        const auto found = _requests.find(pos);
+        if (found == _requests.end()) return;
+
+        // Loads already started still finish through takeReady(), which drops them
+        found->second->cancelled = true;
+        if (found->second->job) _cancelled.push_back(found->second->job);
+        else _queued--;
+        _requests.erase(found);
+    }
+
+    int32_t ChunkLoader::stage(const ChunkPos pos) const {
+        const auto found = _requests.find(pos);
+        return found == _requests.end() ? LOAD_FAILED : found->second->stage.load();
+    }
+
+    void ChunkLoader::setPlayers(const std::vector<ChunkPos>& players) {
+        _players = players;
+
+        // Rebuild the queue with the new distances, which also drops stale entries
+        std::vector<QueueEntry> entries;
+        for (const auto& [pos, request] : _requests) {
+            if (request->stage == LOAD_QUEUED && !request->job) entries.push_back(QueueEntry{distance(pos), pos});
+        }
+        _queue = std::priority_queue<QueueEntry>(std::less<QueueEntry>(), std::move(entries));
+    }
+
+    void ChunkLoader::cancelBeyond(const int64_t distance) {
+        std::vector<ChunkPos> far;
+        for (const auto& [pos, request] : _requests) if (this->distance(pos) > distance) far.push_back(pos);
+        for (const ChunkPos pos : far) cancel(pos);
+    }
+
+    void ChunkLoader::dispatch() {
+        while (_inFlight < MAX_IN_FLIGHT && !_queue.empty()) {
+            const ChunkPos pos = _queue.top().pos;
+            _queue.pop();
+
+            const auto found = _requests.find(pos);
+            if (found == _requests.end() || found->second->job) continue; // Cancelled, or already started
+
+            std::shared_ptr<LoadRequest> request = found->second;
+            _queued--;
+            _inFlight++;
+            request->job = Jobs::submit([this, request] {
+                if (!request->cancelled) load(*request);
+
+                std::lock_guard lock(_readyMtx);
+                _ready.push_back(request);
+            });
+        }
+    }
+
+    std::vector<std::unique_ptr<Chunk>> ChunkLoader::takeReady(const size_t max) {
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::lock_guard lock(_readyMtx);
+
+        size_t taken = 0;
+        for (; taken < _ready.size() && chunks.size() < max; taken++) {
+            const std::shared_ptr<LoadRequest>& request = _ready[taken];
+            _inFlight--;
+
+            // Cancelled requests were already removed, and may have been requested again since
+            const auto found = _requests.find(request->pos);
+            if (found == _requests.end() || found->second != request) continue;
+            _requests.erase(found);
+            if (request->stage == LOAD_READY) chunks.push_back(std::move(request->chunk));
+        }
+        _ready.erase(_ready.begin(), _ready.begin() + taken);
+        std::erase_if(_cancelled, [](const JobHandle& job) { return job->done(); });
+
+        return chunks;
+    }
+
+    void ChunkLoader::load(LoadRequest& request) {
+        PROFILE_ZONE("ChunkLoader::load");
+        const ChunkPos pos = request.pos;
+        std::unique_ptr<Chunk> chunk;
+
+        try {
+            request.stage = LOAD_READ;
+            const File::FileContents compressed = _regions.read(pos);
+            if (request.cancelled) return;
+
+            if (compressed.length()) {
+                request.stage = LOAD_DECOMPRESS;
+                const BKV_t bkv = ChunkSerializer::decompress(compressed);
+                if (request.cancelled) return;
+
+                request.stage = LOAD_DECODE;
+                chunk = ChunkSerializer::decode(bkv);
+                if (!(chunk->pos() == pos)) {
+                    UTF8Str msg = FormatString::formatString("Stored as chunk %d, %d.", chunk->pos().x, chunk->pos().z);
+                    throw std::runtime_error(msg.get());
+                }
+                chunk->setDirty(false);
+            }
+        } catch (std::exception& e) {
+            UTF8Str msg = FormatString::formatString("Could not load chunk %d, %d: %s", pos.x, pos.z, e.what());
+            Logger::log(LOG_ERR, msg);
+            request.stage = LOAD_FAILED;
+            return;
+        }
+
+        if (!chunk) {
+            if (request.cancelled) return;
+            request.stage = LOAD_GENERATE;
+            chunk = _generator.generate(pos);
+        }
+
+        if (request.cancelled) return;
+        request.stage = LOAD_LIGHT;
+        LightEngine::lightChunk(*chunk);
+
+        request.chunk = std::move(chunk);
+        request.stage = LOAD_READY;
+    }
+
+    int64_t ChunkLoader::distance(const ChunkPos pos) const {
+        int64_t nearest = INT64_MAX;
+        for (const ChunkPos player : _players) {
+            const int64_t dx = static_cast<int64_t>(pos.x) - player.x;
+            const int64_t dz = static_cast<int64_t>(pos.z) - player.z;
+            nearest = std::min(nearest, dx * dx + dz * dz);
+        }
+        return nearest;
+    }
+}
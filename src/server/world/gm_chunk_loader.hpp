@@ -0,0 +1,107 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+#include "gm_region_file.hpp"
+#include "gm_terrain_generator.hpp"
+
+#include <common/system/gm_jobs.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace game {
+    enum LOAD_STAGES {
+        LOAD_QUEUED,
+        LOAD_READ, // Reading the compressed chunk from its region file
+        LOAD_DECOMPRESS,
+        LOAD_DECODE,
+        LOAD_GENERATE, // Generating terrain, for chunks that have never been saved
+        LOAD_LIGHT,
+        LOAD_READY,
+        LOAD_FAILED // The saved chunk could not be read, and is left alone rather than generated over
+    };
+
+    // Loads chunks on Jobs in stages: read, decompress, decode, generate if it was never saved, then light.
+    // Requests wait in a queue ordered by distance to the nearest player, and at most MAX_IN_FLIGHT are loaded at once,
+    // so the closest chunks always start first. Cancelled requests are dropped from the queue, or stop at the next stage
+    // if they already started.
+    // Everything but loading itself happens on the thread that owns the loader, which collects finished chunks with
+    // takeReady() and never waits on a load.
+    class ChunkLoader {
+        public:
+            // Constructors
+            ChunkLoader(RegionStorage& regions, const TerrainGenerator& generator) : _regions{regions}, _generator{generator} {}
+            // Cancels every request and waits for the loads already started.
+            ~ChunkLoader();
+
+            ChunkLoader(const ChunkLoader &) = delete;
+            ChunkLoader &operator=(const ChunkLoader &) = delete;
+
+            // Functions
+            // Queues the chunk at @p pos, unless it is already requested.
+            void request(const ChunkPos pos);
+            void cancel(const ChunkPos pos);
+            bool requested(const ChunkPos pos) const { return _requests.count(pos); }
+            // @return The stage the request for @p pos has reached, or LOAD_FAILED if it was not requested
+            int32_t stage(const ChunkPos pos) const;
+
+            // Orders queued requests by distance to the nearest of @p players, the chunks players are in.
+            void setPlayers(const std::vector<ChunkPos>& players);
+            // Cancels requests further than sqrt(@p distance) chunks from every player.
+            void cancelBeyond(const int64_t distance);
+            // @return The squared distance in chunks from @p pos to the nearest player, or INT64_MAX if there are none
+            int64_t distance(const ChunkPos pos) const;
+
+            // Starts queued requests until MAX_IN_FLIGHT are loading.
+            void dispatch();
+            // Removes up to @p max finished chunks. Requests that failed are dropped.
+            std::vector<std::unique_ptr<Chunk>> takeReady(const size_t max);
+
+            size_t queued() const { return _queued; }
+            size_t inFlight() const { return _inFlight; }
+
+            // Variables
+            static constexpr size_t MAX_IN_FLIGHT = 64;
+
+        private:
+            // Types
+            typedef struct LoadRequest_ {
+                ChunkPos pos;
+                std::atomic<int32_t> stage = LOAD_QUEUED;
+                std::atomic<bool> cancelled = false;
+                std::unique_ptr<Chunk> chunk; // Set by the load before it becomes ready
+                JobHandle job;
+            } LoadRequest;
+
+            typedef struct QueueEntry_ {
+                int64_t distance;
+                ChunkPos pos;
+
+                bool operator<(const QueueEntry_& other) const { return distance > other.distance; } // Closest first
+            } QueueEntry;
+
+            // Functions
+            // Runs every stage of @p request on a worker.
+            void load(LoadRequest& request);
+
+            // Variables
+            RegionStorage& _regions;
+            const TerrainGenerator& _generator;
+
+            std::unordered_map<ChunkPos, std::shared_ptr<LoadRequest>, ChunkPosHash> _requests;
+            std::priority_queue<QueueEntry> _queue; // Holds stale entries for cancelled requests, skipped when popped
+            std::vector<ChunkPos> _players;
+            size_t _queued = 0; // Requests not started yet
+            size_t _inFlight = 0;
+            std::vector<JobHandle> _cancelled; // Loads cancelled after they started, waited on before the loader goes away
+
+            std::mutex _readyMtx;
+            std::vector<std::shared_ptr<LoadRequest>> _ready; // Finished on workers, including cancelled loads
+    };
+}
@@ -0,0 +1,39 @@
+#include "gm_chunk_map.hpp"
+
+namespace game {
+    Chunk& ChunkMap::insert(std::unique_ptr<Chunk>&& chunk) {
+        std::unique_ptr<Chunk>& slot = _chunks[chunk->pos()];
+        slot = std::move(chunk);
+        return *slot;
+    }
+
+    Chunk& ChunkMap::create(const ChunkPos pos) {
+        std::unique_ptr<Chunk>& slot = _chunks[pos];
+        if (!slot) slot = std::make_unique<Chunk>(pos);
+        return *slot;
+    }
+
+    std::unique_ptr<Chunk> ChunkMap::erase(const ChunkPos pos) {
+        const auto found = _chunks.find(pos);
+        if (found == _chunks.end()) return nullptr;
+
+        std::unique_ptr<Chunk> chunk = std::move(found->second);
+        _chunks.erase(found);
+        return chunk;
+    }
+
+    bool ChunkMap::setBlock(const int32_t x, const int32_t y, const int32_t z, const BlockID block) {
+        if (y < 0 || y >= static_cast<int32_t>(Chunk::HEIGHT)) return false;
+        Chunk* chunk = find(ChunkPos::fromBlock(x, z));
+        if (!chunk) return false;
+
+        chunk->setBlock(x & 15, y, z & 15, block);
+        return true;
+    }
+
+    size_t ChunkMap::memoryUsage() const {
+        size_t usage = 0;
+        for (const auto& [pos, chunk] : _chunks) usage += chunk->memoryUsage();
+        return usage;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace game {
+    // The loaded chunks of a world, keyed by chunk position, with block access in world coordinates.
+    class ChunkMap {
+        public:
+            // Types
+            typedef std::unordered_map<ChunkPos, std::unique_ptr<Chunk>, ChunkPosHash> Map;
+
+            // Constructors
+            ChunkMap() {}
+
+            ChunkMap(const ChunkMap &) = delete;
+            ChunkMap &operator=(const ChunkMap &) = delete;
+
+            // Functions
+            // @return The chunk at @p pos, or nullptr if it is not loaded
+            Chunk* find(const ChunkPos pos) {
+                const auto found = _chunks.find(pos);
+                return found == _chunks.end() ? nullptr : found->second.get();
+            }
+            const Chunk* find(const ChunkPos pos) const {
+                const auto found = _chunks.find(pos);
+                return found == _chunks.end() ? nullptr : found->second.get();
+            }
+
+            // Adds @p chunk, replacing any chunk already loaded at its position.
+            Chunk& insert(std::unique_ptr<Chunk>&& chunk);
+            // @return The chunk at @p pos, created empty if it was not loaded
+            Chunk& create(const ChunkPos pos);
+            // Unloads the chunk at @p pos.
+            // @return The chunk, or nullptr if it was not loaded
+            std::unique_ptr<Chunk> erase(const ChunkPos pos);
+
+            // @return The block at world coordinates, or air if its chunk is not loaded or @p y is outside the world
+            BlockID getBlock(const int32_t x, const int32_t y, const int32_t z) const {
+                if (y < 0 || y >= static_cast<int32_t>(Chunk::HEIGHT)) return Blocks::AIR;
+                const Chunk* chunk = find(ChunkPos::fromBlock(x, z));
+                return chunk ? chunk->getBlock(x & 15, y, z & 15) : Blocks::AIR;
+            }
+            // @return False if the block's chunk is not loaded or @p y is outside the world
+            bool setBlock(const int32_t x, const int32_t y, const int32_t z, const BlockID block);
+
+            size_t size() const { return _chunks.size(); }
+            size_t memoryUsage() const;
+
+            Map::iterator begin() { return _chunks.begin(); }
+            Map::iterator end() { return _chunks.end(); }
+            Map::const_iterator begin() const { return _chunks.begin(); }
+            Map::const_iterator end() const { return _chunks.end(); }
+
+        private:
+            // Variables
+            Map _chunks;
+    };
+}
@@ -0,0 +1,72 @@
+#include "gm_chunk_serializer.hpp"
+
+#include <common/data/bkv/gm_bkv_builder.hpp>
+#include <common/data/bkv/gm_bkv_reader.hpp>
+#include <common/data/file/gm_compression.hpp>
+#include <common/headers/string.hpp>
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace game {
+    BKV_t ChunkSerializer::encode(const Chunk& chunk) {
+        BKV_Builder builder;
+        builder.setInt<uint8_t>("version", VERSION);
+        builder.setInt<int32_t>("x", chunk.pos().x);
+        builder.setInt<int32_t>("z", chunk.pos().z);
+
+        builder.openCompound("sections");
+        for (uint32_t i = 0; i < Chunk::SECTIONS; i++) {
+            const ChunkSection* section = chunk.section(i);
+            if (!section) continue;
+
+            char key[4];
+            std::snprintf(key, sizeof(key), "%u", i);
+            builder.openCompound(key);
+            builder.setInt<uint8_t>("bits", static_cast<uint8_t>(section->bits()));
+            builder.setIntList<uint16_t>("palette", section->palette().data(), static_cast<uint16_t>(section->palette().size()));
+            builder.setIntList<uint64_t>("data", section->data().data(), static_cast<uint16_t>(section->data().size()));
+            builder.closeCompound();
+        }
+        builder.closeCompound();
+
+        return builder.build();
+    }
+
+    std::unique_ptr<Chunk> ChunkSerializer::decode(const BKV_t& bkv) {
+        const BKV_Reader reader(bkv);
+        const uint8_t version = reader.getInt<uint8_t>("version", 0);
+        if (version != VERSION) {
+            UTF8Str msg = FormatString::formatString("Unsupported chunk version: %u", version);
+            throw std::runtime_error(msg.get());
+        }
+        if (!reader.contains("x") || !reader.contains("z")) throw std::runtime_error("Chunk has no position.");
+
+        std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(ChunkPos{reader.getInt<int32_t>("x", 0), reader.getInt<int32_t>("z", 0)});
+        const BKV_Reader sections = reader.getCompound("sections");
+        for (uint32_t i = 0; i < Chunk::SECTIONS; i++) {
+            char key[4];
+            std::snprintf(key, sizeof(key), "%u", i);
+            if (!sections.contains(key)) continue;
+
+            const BKV_Reader section = sections.getCompound(key);
+            chunk->setSection(i, std::make_unique<ChunkSection>(
+                section.getIntList<uint16_t>("palette"),
+                section.getIntList<uint64_t>("data"),
+                section.getInt<uint8_t>("bits", 0)
+            ));
+        }
+
+        return chunk;
+    }
+
+    File::FileContents ChunkSerializer::compress(const BKV_t& bkv) {
+        return Compression::compress(File::FileContents{static_cast<size_t>(bkv.size()), bkv.data()}, Compression::CODEC_LZ4);
+    }
+
+    BKV_t ChunkSerializer::decompress(const File::FileContents& compressed) {
+        const File::FileContents contents = Compression::decompress(compressed);
+        // The BKV shares the decompressed buffer instead of copying it
+        return BKV_t{static_cast<int64_t>(contents.length()), std::shared_ptr<const uint8_t>(contents.get(), [contents](const uint8_t*) {})};
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+
+#include <common/data/bkv/gm_bkv.hpp>
+#include <common/data/file/gm_file.hpp>
+
+#include <memory>
+
+namespace game {
+    // Converts chunks to and from the BKV compounds stored in region files:
+    // { version: UI8, x: I32, z: I32, sections: { "<height>": { bits: UI8, palette: UI16[], data: UI64[] }, ... } }
+    // Sections that are all air are left out.
+    class ChunkSerializer {
+        public:
+            // Functions
+            static BKV_t encode(const Chunk& chunk);
+            // Throws std::runtime_error if @p bkv is not a valid chunk.
+            static std::unique_ptr<Chunk> decode(const BKV_t& bkv);
+
+            // Each chunk is compressed on its own, so it can be read and rewritten without touching its neighbours.
+            static File::FileContents compress(const BKV_t& bkv);
+            static BKV_t decompress(const File::FileContents& compressed);
+
+            // Variables
+            static constexpr uint8_t VERSION = 1;
+    };
+}
@@ -0,0 +1,119 @@
+#include "gm_entity_serializer.hpp"
+
+#include <common/data/bkv/gm_bkv_builder.hpp>
+#include <common/data/bkv/gm_bkv_reader.hpp>
+#include <common/headers/string.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace game {
+    EntitySnapshot EntitySerializer::snapshot(TransformPool& transforms) {
+        const size_t count = transforms.size();
+        EntitySnapshot snapshot{
+            std::vector<glm::dvec3>(transforms.positions(), transforms.positions() + count),
+            std::vector<glm::dquat>(transforms.rotations(), transforms.rotations() + count),
+            std::vector<glm::dvec3>(transforms.scales(), transforms.scales() + count),
+            std::vector<uint32_t>(count)
+        };
+
+        for (size_t i = 0; i < count; i++) {
+            const Entity parent = transforms.parent(transforms.entity(i));
+            snapshot.parents[i] = parent == EntityPool::NULL_ENTITY ? NO_PARENT : static_cast<uint32_t>(transforms.indexOf(parent));
+        }
+        return snapshot;
+    }
+
+    BKV_t EntitySerializer::encode(const EntitySnapshot& snapshot) {
+        const size_t count = snapshot.positions.size();
+        BKV_Builder builder;
+        builder.setInt<uint8_t>("version", VERSION);
+        builder.setInt<uint32_t>("count", static_cast<uint32_t>(count));
+
+        std::vector<float64_t> positions, rotations, scales;
+        builder.openCompound("groups");
+        for (size_t begin = 0; begin < count; begin += GROUP_SIZE) {
+            const size_t end = std::min(begin + GROUP_SIZE, count);
+            positions.clear();
+            rotations.clear();
+            scales.clear();
+            for (size_t i = begin; i < end; i++) {
+                const glm::dvec3& position = snapshot.positions[i];
+                const glm::dquat& rotation = snapshot.rotations[i];
+                const glm::dvec3& scale = snapshot.scales[i];
+                positions.insert(positions.end(), {position.x, position.y, position.z});
+                rotations.insert(rotations.end(), {rotation.w, rotation.x, rotation.y, rotation.z});
+                scales.insert(scales.end(), {scale.x, scale.y, scale.z});
+            }
+
+            char key[16];
+            std::snprintf(key, sizeof(key), "%zu", begin / GROUP_SIZE);
+            builder.openCompound(key);
+            builder.setDoubleList("positions", positions.data(), static_cast<uint16_t>(positions.size()));
+            builder.setDoubleList("rotations", rotations.data(), static_cast<uint16_t>(rotations.size()));
+            builder.setDoubleList("scales", scales.data(), static_cast<uint16_t>(scales.size()));
+            builder.setIntList<uint32_t>("parents", snapshot.parents.data() + begin, static_cast<uint16_t>(end - begin));
+            builder.closeCompound();
+        }
+        builder.closeCompound();
+
+        return builder.build();
+    }
+
+    size_t EntitySerializer::decode(const BKV_t& bkv, EntityPool& entityPool, TransformPool& transforms) {
+        const BKV_Reader reader(bkv);
+        const uint8_t version = reader.getInt<uint8_t>("version", 0);
+        if (version != VERSION) {
+            UTF8Str msg = FormatString::formatString("Unsupported entity version: %u", version);
+            throw std::runtime_error(msg.get());
+        }
+
+        // Read everything first, so bad data does not leave half the entities created
+        const size_t count = reader.getInt<uint32_t>("count", 0);
+        std::vector<float64_t> positions, rotations, scales;
+        std::vector<uint32_t> parents;
+        const BKV_Reader groups = reader.getCompound("groups");
+        for (size_t group = 0; group * GROUP_SIZE < count; group++) {
+            char key[16];
+            std::snprintf(key, sizeof(key), "%zu", group);
+            const BKV_Reader values = groups.getCompound(key);
+            const std::vector<float64_t> groupPositions = values.getDoubleList("positions");
+            const std::vector<float64_t> groupRotations = values.getDoubleList("rotations");
+            const std::vector<float64_t> groupScales = values.getDoubleList("scales");
+            const std::vector<uint32_t> groupParents = values.getIntList<uint32_t>("parents");
+
+            const size_t size = std::min(static_cast<size_t>(GROUP_SIZE), count - group * GROUP_SIZE);
+            if (groupPositions.size() != size * 3 || groupRotations.size() != size * 4 || groupScales.size() != size * 3 ||
+                groupParents.size() != size
+            ) {
+                UTF8Str msg = FormatString::formatString("Entity group %lu is the wrong size.", group);
+                throw std::runtime_error(msg.get());
+            }
+            positions.insert(positions.end(), groupPositions.begin(), groupPositions.end());
+            rotations.insert(rotations.end(), groupRotations.begin(), groupRotations.end());
+            scales.insert(scales.end(), groupScales.begin(), groupScales.end());
+            parents.insert(parents.end(), groupParents.begin(), groupParents.end());
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (parents[i] != NO_PARENT && parents[i] >= i) {
+                UTF8Str msg = FormatString::formatString("Entity %lu has a parent after it.", i);
+                throw std::runtime_error(msg.get());
+            }
+        }
+
+        // Parents come first, so each transform's parent already exists when it is created
+        std::vector<Entity> entities(count);
+        for (size_t i = 0; i < count; i++) {
+            WorldTransform transform{};
+            transform.position = glm::dvec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+            transform.rotation = glm::dquat(rotations[i * 4], rotations[i * 4 + 1], rotations[i * 4 + 2], rotations[i * 4 + 3]);
+            transform.scale = glm::dvec3(scales[i * 3], scales[i * 3 + 1], scales[i * 3 + 2]);
+
+            entities[i] = entityPool.create();
+            transforms.create(entities[i], transform);
+            if (parents[i] != NO_PARENT) transforms.setParent(entities[i], entities[parents[i]]);
+        }
+        return count;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <common/data/bkv/gm_bkv.hpp>
+#include <server/components/gm_transform_component.hpp>
+#include <server/entities/gm_entity.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+    // The local transforms of every entity with one, copied at a tick boundary so they can be saved on another thread.
+    // Transforms are in the pool's pre-order, so every parent comes before its children.
+    typedef struct EntitySnapshot_ {
+        std::vector<glm::dvec3> positions;
+        std::vector<glm::dquat> rotations;
+        std::vector<glm::dvec3> scales;
+        std::vector<uint32_t> parents; // Index of the parent transform, or NO_PARENT for roots
+    } EntitySnapshot;
+
+    // Converts entity transforms to and from the BKV compound saved with a world:
+    // { version: UI8, count: UI32, groups: { "<n>": { positions: F64[], rotations: F64[], scales: F64[], parents: UI32[] }, ... } }
+    // Entity handles are not saved, since entities get new ones when they are loaded.
+    class EntitySerializer {
+        public:
+            // Functions
+            static EntitySnapshot snapshot(TransformPool& transforms);
+            static BKV_t encode(const EntitySnapshot& snapshot);
+            // Creates an entity with a transform for every saved transform.
+            // Throws std::runtime_error if @p bkv is not valid, before any entity is created.
+            // @return The number of entities created
+            static size_t decode(const BKV_t& bkv, EntityPool& entityPool, TransformPool& transforms);
+
+            // Variables
+            static constexpr uint8_t VERSION = 1;
+            static constexpr uint32_t NO_PARENT = UINT32_MAX;
+            static constexpr uint32_t GROUP_SIZE = 4096; // Transforms per group, which keeps each list under the BKV limit
+    };
+}
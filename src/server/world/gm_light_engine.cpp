@@ -0,0 +1,334 @@
+#include "gm_light_engine.hpp"
+
+#include <common/system/gm_jobs.hpp>
+#include <common/system/gm_profiler.hpp>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace game {
+    typedef struct LightNode_ {
+        int32_t x;
+        int32_t y;
+        int32_t z;
+        uint8_t level; // Light the block had before it was removed, for removal queues
+    } LightNode;
+
+    // A block's light and what it is made of
+    typedef struct LightCell_ {
+        LightSection* light;
+        uint32_t index; // In light and in the block section
+        BlockID block;
+    } LightCell;
+
+    // First in, first out, in one flat array that doubles when full, so a flood allocates only until it has grown to
+    // the size it needs.
+    class LightQueue {
+        public:
+            // Constructors
+            LightQueue() : _nodes(LightEngine::INITIAL_QUEUE_SIZE) {}
+
+            // Functions
+            bool empty() const { return _head == _tail; }
+            void push(const LightNode& node) {
+                if (_tail - _head == _nodes.size()) grow();
+                _nodes[_tail++ & (_nodes.size() - 1)] = node;
+            }
+            LightNode pop() { return _nodes[_head++ & (_nodes.size() - 1)]; }
+
+        private:
+            // Functions
+            void grow() {
+                std::vector<LightNode> nodes(_nodes.size() * 2);
+                for (size_t i = _head; i < _tail; i++) nodes[i - _head] = _nodes[i & (_nodes.size() - 1)];
+                _tail -= _head;
+                _head = 0;
+                _nodes.swap(nodes);
+            }
+
+            // Variables
+            std::vector<LightNode> _nodes; // A power of two in size
+            size_t _head = 0;
+            size_t _tail = 0;
+    };
+
+    // The blocks of one chunk, in chunk coordinates, for lighting it before it joins a map
+    class ChunkLightCells {
+        public:
+            // Constructors
+            ChunkLightCells(Chunk& chunk) : _chunk{chunk} {}
+
+            // Functions
+            bool cell(const int32_t x, const int32_t y, const int32_t z, LightCell& cell) {
+                if (static_cast<uint32_t>(x) >= ChunkSection::SIZE || static_cast<uint32_t>(z) >= ChunkSection::SIZE ||
+                    static_cast<uint32_t>(y) >= Chunk::HEIGHT
+                ) return false;
+
+                const ChunkSection* section = _chunk.section(y / ChunkSection::SIZE);
+                cell.light = &_chunk.lightSection(y / ChunkSection::SIZE);
+                cell.index = ChunkSection::index(x, y % ChunkSection::SIZE, z);
+                cell.block = section ? section->get(cell.index) : Blocks::AIR;
+                return true;
+            }
+
+        private:
+            // Variables
+            Chunk& _chunk;
+    };
+
+    // The blocks of every loaded chunk, in world coordinates, keeping the chunk last looked up
+    class MapLightCells {
+        public:
+            // Constructors
+            MapLightCells(ChunkMap& chunks) : _chunks{chunks} {}
+
+            // Functions
+            Chunk* chunk(const ChunkPos pos) {
+                if (!_cached || !(pos == _pos)) {
+                    _chunk = _chunks.find(pos);
+                    _pos = pos;
+                    _cached = true;
+                }
+                return _chunk;
+            }
+
+            bool cell(const int32_t x, const int32_t y, const int32_t z, LightCell& cell) {
+                if (y < 0 || y >= static_cast<int32_t>(Chunk::HEIGHT)) return false;
+                Chunk* loaded = chunk(ChunkPos::fromBlock(x, z));
+                if (!loaded) return false;
+
+                const ChunkSection* section = loaded->section(y / ChunkSection::SIZE);
+                cell.light = &loaded->lightSection(y / ChunkSection::SIZE);
+                cell.index = ChunkSection::index(x & 15, y % ChunkSection::SIZE, z & 15);
+                cell.block = section ? section->get(cell.index) : Blocks::AIR;
+                return true;
+            }
+
+        private:
+            // Variables
+            ChunkMap& _chunks;
+            Chunk* _chunk = nullptr;
+            ChunkPos _pos{0, 0};
+            bool _cached = false;
+    };
+
+    // Down first, which is the only direction full sky light keeps its level in
+    static constexpr int32_t NEIGHBOURS_[6][3] = {{0, -1, 0}, {0, 1, 0}, {-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}};
+
+    // @return The light @p cell gives off itself, at height @p y
+    static uint8_t sourceLevel_(const uint32_t channel, const LightCell& cell, const int32_t y) {
+        const BlockInfo& info = Blocks::info(cell.block);
+        if (channel == LIGHT_BLOCK) return info.emission;
+        return y == static_cast<int32_t>(Chunk::HEIGHT) - 1 && info.opacity == 0 ? LightEngine::MAX_LIGHT : 0;
+    }
+
+    // Spreads the light of every block in @p queue to its neighbours, and on from every neighbour it raised.
+    template<typename Cells>
+    static void spread_(Cells& cells, LightQueue& queue, const uint32_t channel) {
+        LightCell from, to;
+        while (!queue.empty()) {
+            const LightNode node = queue.pop();
+            if (!cells.cell(node.x, node.y, node.z, from)) continue;
+            const uint8_t level = from.light->get(channel, from.index);
+            if (level <= 1) continue;
+
+            for (uint32_t i = 0; i < 6; i++) {
+                const int32_t x = node.x + NEIGHBOURS_[i][0], y = node.y + NEIGHBOURS_[i][1], z = node.z + NEIGHBOURS_[i][2];
+                if (!cells.cell(x, y, z, to)) continue;
+                const uint8_t opacity = Blocks::info(to.block).opacity;
+                if (opacity >= LightEngine::MAX_LIGHT) continue;
+
+                const bool skyFall = channel == LIGHT_SKY && i == 0 && level == LightEngine::MAX_LIGHT && opacity == 0;
+                const int32_t target = skyFall ? level : level - std::max<int32_t>(1, opacity);
+                if (target <= 0 || to.light->get(channel, to.index) >= target) continue;
+
+                to.light->set(channel, to.index, static_cast<uint8_t>(target));
+                queue.push(LightNode{x, y, z, 0});
+            }
+        }
+    }
+
+    // Darkens every block that was lit through the blocks in @p removed, which have already been darkened. Blocks
+    // lit some other way are queued in @p added, to spread their light back into the dark.
+    template<typename Cells>
+    static void unspread_(Cells& cells, LightQueue& removed, LightQueue& added, const uint32_t channel) {
+        LightCell to;
+        while (!removed.empty()) {
+            const LightNode node = removed.pop();
+            for (uint32_t i = 0; i < 6; i++) {
+                const int32_t x = node.x + NEIGHBOURS_[i][0], y = node.y + NEIGHBOURS_[i][1], z = node.z + NEIGHBOURS_[i][2];
+                if (!cells.cell(x, y, z, to)) continue;
+                const uint8_t level = to.light->get(channel, to.index);
+                if (level == 0) continue;
+
+                const bool skyFall = channel == LIGHT_SKY && i == 0 && node.level == LightEngine::MAX_LIGHT;
+                if (level >= node.level && !(skyFall && level == LightEngine::MAX_LIGHT)) {
+                    added.push(LightNode{x, y, z, 0});
+                    continue;
+                }
+
+                to.light->set(channel, to.index, 0);
+                removed.push(LightNode{x, y, z, level});
+
+                // Sources keep their own light
+                const uint8_t source = sourceLevel_(channel, to, y);
+                if (source) {
+                    to.light->set(channel, to.index, source);
+                    added.push(LightNode{x, y, z, 0});
+                }
+            }
+        }
+    }
+
+    // Queues the blocks on both sides of every border between the chunk at @p pos and its loaded neighbours.
+    static void stitch_(MapLightCells& cells, LightQueue& queue, const ChunkPos pos, const uint32_t channel) {
+        Chunk* chunk = cells.chunk(pos);
+        if (!chunk) return;
+
+        static constexpr int32_t SIDES[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (const auto& [dx, dz] : SIDES) {
+            const ChunkPos next{pos.x + dx, pos.z + dz};
+            const Chunk* neighbour = cells.chunk(next);
+            if (!neighbour) continue;
+
+            // Border columns of this chunk, then the neighbour's across from them, in world coordinates
+            const int32_t x = pos.x * 16 + (dx < 0 ? 0 : 15), z = pos.z * 16 + (dz < 0 ? 0 : 15);
+            for (uint32_t section = 0; section < Chunk::SECTIONS; section++) {
+                const LightSection& ours = chunk->lightSection(section);
+                const LightSection& theirs = neighbour->lightSection(section);
+                if (ours.uniform(channel) && theirs.uniform(channel) && ours.get(channel, 0) == theirs.get(channel, 0)) continue;
+
+                for (int32_t y = section * ChunkSection::SIZE; y < static_cast<int32_t>((section + 1) * ChunkSection::SIZE); y++) {
+                    for (int32_t i = 0; i < 16; i++) {
+                        const int32_t bx = dx ? x : pos.x * 16 + i, bz = dz ? z : pos.z * 16 + i;
+                        queue.push(LightNode{bx, y, bz, 0});
+                        queue.push(LightNode{bx + dx, y, bz + dz, 0});
+                    }
+                }
+            }
+        }
+    }
+
+    void LightEngine::lightChunk(Chunk& chunk) {
+        ChunkLightCells cells{chunk};
+        LightQueue queue;
+
+        // Sections above the highest block are open sky
+        uint32_t top = Chunk::SECTIONS;
+        while (top > 0 && !chunk.section(top - 1)) top--;
+        for (uint32_t section = 0; section < Chunk::SECTIONS; section++) {
+            chunk.lightSection(section).fill(LIGHT_SKY, section < top ? 0 : MAX_LIGHT);
+            chunk.lightSection(section).fill(LIGHT_BLOCK, 0);
+        }
+
+        // Full sky light falls straight down each column until something stops it
+        const int32_t surface = static_cast<int32_t>(top * ChunkSection::SIZE);
+        std::array<int32_t, ChunkSection::SIZE * ChunkSection::SIZE> lowest; // Lowest block with full sky light
+        for (uint32_t z = 0; z < 16; z++) {
+            for (uint32_t x = 0; x < 16; x++) {
+                int32_t y = surface;
+                while (y > 0 && Blocks::info(chunk.getBlock(x, y - 1, z)).opacity == 0) {
+                    chunk.setLight(LIGHT_SKY, x, --y, z, MAX_LIGHT);
+                }
+                lowest[z * 16 + x] = y;
+            }
+        }
+
+        // Then spreads sideways wherever a neighbouring column is lit further down, and down into what stopped it
+        for (int32_t z = 0; z < 16; z++) {
+            for (int32_t x = 0; x < 16; x++) {
+                const int32_t bottom = lowest[z * 16 + x];
+                int32_t highest = bottom + 1;
+                if (x > 0) highest = std::max(highest, lowest[z * 16 + x - 1]);
+                if (x < 15) highest = std::max(highest, lowest[z * 16 + x + 1]);
+                if (z > 0) highest = std::max(highest, lowest[(z - 1) * 16 + x]);
+                if (z < 15) highest = std::max(highest, lowest[(z + 1) * 16 + x]);
+                for (int32_t y = bottom; y < std::min(highest, static_cast<int32_t>(Chunk::HEIGHT)); y++) queue.push(LightNode{x, y, z, 0});
+            }
+        }
+        spread_(cells, queue, LIGHT_SKY);
+
+        // Block light, skipping sections whose palette gives off none
+        for (uint32_t index = 0; index < top; index++) {
+            const ChunkSection* section = chunk.section(index);
+            if (!section) continue;
+            if (section->bits() != ChunkSection::DIRECT_BITS && std::none_of(section->palette().begin(), section->palette().end(),
+                [](const BlockID block) { return Blocks::info(block).emission > 0; }
+            )) continue;
+
+            LightSection& light = chunk.lightSection(index);
+            for (uint32_t i = 0; i < ChunkSection::VOLUME; i++) {
+                const uint8_t emission = Blocks::info(section->get(i)).emission;
+                if (!emission) continue;
+
+                light.set(LIGHT_BLOCK, i, emission);
+                const int32_t x = i & 15, y = index * ChunkSection::SIZE + (i >> 8), z = (i >> 4) & 15;
+                queue.push(LightNode{x, y, z, 0});
+            }
+        }
+        spread_(cells, queue, LIGHT_BLOCK);
+    }
+
+    void LightEngine::blockChanged(const int32_t x, const int32_t y, const int32_t z) {
+        _pending[ChunkPos::fromBlock(x, z)].changed.push_back(Block{x, y, z});
+    }
+
+    void LightEngine::chunkAdded(const ChunkPos pos) {
+        _pending[pos].added = true;
+    }
+
+    void LightEngine::update() {
+        if (_pending.empty()) return;
+        PROFILE_ZONE("LightEngine::update");
+
+        // Chunks in the same pass are at least 3 apart on one axis, so the chunks around them never overlap
+        std::array<std::vector<std::pair<ChunkPos, const Pending*>>, 9> passes;
+        for (const auto& [pos, pending] : _pending) passes[((pos.x % 3 + 3) % 3) * 3 + (pos.z % 3 + 3) % 3].emplace_back(pos, &pending);
+
+        for (const std::vector<std::pair<ChunkPos, const Pending*>>& pass : passes) {
+            Jobs::parallelFor(pass.size(), 1, [&](const size_t begin, const size_t end) {
+                MapLightCells cells{_chunks};
+                LightQueue removed, added;
+                LightCell cell;
+                for (size_t i = begin; i < end; i++) {
+                    const auto& [pos, pending] = pass[i];
+                    for (uint32_t channel = 0; channel < LIGHT_CHANNEL_COUNT; channel++) {
+                        // Take out the light that came through the changed blocks
+                        for (const Block& block : pending->changed) {
+                            if (!cells.cell(block.x, block.y, block.z, cell)) continue;
+                            const uint8_t level = cell.light->get(channel, cell.index);
+                            if (!level) continue;
+                            cell.light->set(channel, cell.index, 0);
+                            removed.push(LightNode{block.x, block.y, block.z, level});
+                        }
+                        unspread_(cells, removed, added, channel);
+
+                        // Then let the light around them back in, and add their own
+                        for (const Block& block : pending->changed) {
+                            if (!cells.cell(block.x, block.y, block.z, cell)) continue;
+                            const uint8_t source = sourceLevel_(channel, cell, block.y);
+                            if (source > cell.light->get(channel, cell.index)) {
+                                cell.light->set(channel, cell.index, source);
+                                added.push(LightNode{block.x, block.y, block.z, 0});
+                            }
+                            for (const auto& [dx, dy, dz] : NEIGHBOURS_) added.push(LightNode{block.x + dx, block.y + dy, block.z + dz, 0});
+                        }
+
+                        if (pending->added) stitch_(cells, added, pos, channel);
+                        spread_(cells, added, channel);
+                    }
+                }
+            });
+        }
+        _pending.clear();
+    }
+
+    uint8_t LightEngine::light(const uint32_t channel, const int32_t x, const int32_t y, const int32_t z) const {
+        if (y >= static_cast<int32_t>(Chunk::HEIGHT)) return channel == LIGHT_SKY ? MAX_LIGHT : 0;
+        if (y < 0) return 0;
+
+        const Chunk* chunk = _chunks.find(ChunkPos::fromBlock(x, z));
+        return chunk ? chunk->light(channel, x & 15, y, z & 15) : 0;
+    }
+}
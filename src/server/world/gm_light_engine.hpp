@@ -0,0 +1,69 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+#include "gm_chunk_map.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace game {
+    // Keeps the sky and block light of loaded chunks up to date by flood filling it breadth first.
+    // Light loses 1 level per block it spreads, plus the opacity of the block it enters, except that full sky light
+    // goes straight down through transparent blocks without fading. Block light starts at each block's emission.
+    //
+    // Chunks are lit on their own when loaded, by lightChunk() on the loader's workers, and their light is carried
+    // over the borders with their neighbours once they join the world. Changed blocks are relit incrementally: the
+    // light that came through them is removed, then the light still around them is spread back in.
+    //
+    // Light never spreads more than 15 blocks, so a change only touches its own chunk and the 8 around it. update()
+    // relights chunks in 9 passes, one per position modulo 3, and the chunks of a pass are far enough apart to be
+    // relit in parallel.
+    class LightEngine {
+        public:
+            // Constructors
+            LightEngine(ChunkMap& chunks) : _chunks{chunks} {}
+
+            LightEngine(const LightEngine &) = delete;
+            LightEngine &operator=(const LightEngine &) = delete;
+
+            // Functions
+            // Lights @p chunk as if none of its neighbours were loaded. Safe on any thread for a chunk in no map.
+            static void lightChunk(Chunk& chunk);
+
+            // Queues the block at world coordinates to be relit by the next update(), after it was changed.
+            void blockChanged(const int32_t x, const int32_t y, const int32_t z);
+            // Queues light to be carried over the borders of the chunk at @p pos, which was just added to the map.
+            void chunkAdded(const ChunkPos pos);
+            // Relights everything queued since the last update(), spread over Jobs.
+            void update();
+            size_t pending() const { return _pending.size(); }
+
+            // @return The light at world coordinates, which is full sky light above the world and none below it or in
+            //         chunks that are not loaded
+            uint8_t light(const uint32_t channel, const int32_t x, const int32_t y, const int32_t z) const;
+
+            // Variables
+            static constexpr uint8_t MAX_LIGHT = 15;
+            static constexpr size_t INITIAL_QUEUE_SIZE = 4096; // Queue entries, grown by doubling
+
+        private:
+            // Types
+            typedef struct Block_ {
+                int32_t x;
+                int32_t y;
+                int32_t z;
+            } Block;
+
+            // The work queued for one chunk
+            typedef struct Pending_ {
+                std::vector<Block> changed;
+                bool added = false;
+            } Pending;
+
+            // Variables
+            ChunkMap& _chunks;
+            std::unordered_map<ChunkPos, Pending, ChunkPosHash> _pending;
+    };
+}
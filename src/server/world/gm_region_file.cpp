@@ -0,0 +1,219 @@
+#include "gm_region_file.hpp"
+
+#include <common/data/gm_endianness.hpp>
+#include <common/headers/file.hpp>
+#include <common/headers/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace game {
+    // RegionFile //
+    RegionFile::RegionFile(const char*__restrict__ filepath) {
+        _path = FormatString::formatString("%s", filepath); // Own a copy, @p filepath may not outlive this
+
+        _file = std::fopen(filepath, "r+b");
+        if (!_file) {
+            // New region, with an empty header
+            File::ensureParentDir(_path);
+            _file = std::fopen(filepath, "w+b");
+            if (!_file) {
+                UTF8Str msg = FormatString::formatString("Could not open file: %s", filepath);
+                Logger::crash(msg);
+            }
+
+            const std::vector<uint8_t> header(HEADER_SECTORS * SECTOR_SIZE, 0);
+            writeAt(0, header.data(), header.size());
+            sync();
+        }
+
+        uint8_t header[HEADER_SECTORS * SECTOR_SIZE];
+        std::fseek(_file, 0, SEEK_END);
+        const long size = std::ftell(_file);
+        std::fseek(_file, 0, SEEK_SET);
+        if (size < static_cast<long>(sizeof(header)) || std::fread(header, 1, sizeof(header), _file) != sizeof(header)) {
+            UTF8Str msg = FormatString::formatString("Region file header is truncated: %s", filepath);
+            Logger::crash(msg);
+        }
+
+        _usedSectors.assign((size + SECTOR_SIZE - 1) / SECTOR_SIZE, false);
+        std::fill_n(_usedSectors.begin(), HEADER_SECTORS, true);
+        for (uint32_t i = 0; i < CHUNKS; i++) {
+            uint32_t location, timestamp;
+            std::memcpy(&location, header + i * sizeof(uint32_t), sizeof(uint32_t));
+            std::memcpy(&timestamp, header + (CHUNKS + i) * sizeof(uint32_t), sizeof(uint32_t));
+            location = Endianness::ntoh(location);
+
+            // Drop entries pointing outside the file, so a damaged header only loses those chunks
+            const uint32_t first = location >> 8, count = location & 0xFF;
+            if (location && (first < HEADER_SECTORS || count == 0 || first + count > _usedSectors.size())) {
+                UTF8Str msg = FormatString::formatString("Discarding chunk %u with an invalid location in region file: %s", i, filepath);
+                Logger::log(LOG_WARN, msg);
+                continue;
+            }
+
+            _locations[i] = location;
+            _timestamps[i] = Endianness::ntoh(timestamp);
+            std::fill_n(_usedSectors.begin() + first, count, true);
+        }
+    }
+
+    RegionFile::~RegionFile() {
+        if (!_file) return;
+        // Whoever opens the file next frees what it no longer points at, so the header has to be on disk first
+        if (!_released.empty()) sync();
+        std::fclose(_file);
+    }
+
+    File::FileContents RegionFile::read(const ChunkPos pos) {
+        std::lock_guard lock(_mtx);
+        const uint32_t location = _locations[slot(pos)];
+        if (!location) return File::FileContents{};
+
+        uint32_t len;
+        std::fseek(_file, static_cast<long>(location >> 8) * SECTOR_SIZE, SEEK_SET);
+        if (std::fread(&len, 1, sizeof(len), _file) != sizeof(len)) {
+            UTF8Str msg = FormatString::formatString("Could not read chunk from region file: %s", _path.get());
+            throw std::runtime_error(msg.get());
+        }
+        len = Endianness::ntoh(len);
+        if (sizeof(len) + len > (location & 0xFF) * SECTOR_SIZE) {
+            UTF8Str msg = FormatString::formatString("Chunk is longer than its sectors in region file: %s", _path.get());
+            throw std::runtime_error(msg.get());
+        }
+
+        uint8_t* data = static_cast<uint8_t*>(std::malloc(len));
+        if (std::fread(data, 1, len, _file) != len) {
+            std::free(data);
+            UTF8Str msg = FormatString::formatString("Could not read chunk from region file: %s", _path.get());
+            throw std::runtime_error(msg.get());
+        }
+        return File::FileContents{len, std::shared_ptr<const uint8_t>(data, std::free)};
+    }
+
+    void RegionFile::write(const ChunkPos pos, const File::FileContents& compressed) {
+        const uint32_t count = (sizeof(uint32_t) + compressed.length() + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (count > MAX_CHUNK_SECTORS) {
+            UTF8Str msg = FormatString::formatString("Chunk %d, %d is too big to save: %lu bytes.", pos.x, pos.z, compressed.length());
+            throw std::runtime_error(msg.get());
+        }
+
+        std::lock_guard lock(_mtx);
+        const uint32_t first = allocate(count);
+
+        // Length, data, then padding to the end of the last sector
+        std::vector<uint8_t> sectors(count * SECTOR_SIZE, 0);
+        const uint32_t len = Endianness::hton(static_cast<uint32_t>(compressed.length()));
+        std::memcpy(sectors.data(), &len, sizeof(len));
+        std::memcpy(sectors.data() + sizeof(len), compressed.get(), compressed.length());
+        writeAt(static_cast<int64_t>(first) * SECTOR_SIZE, sectors.data(), sectors.size());
+        if (first + count > _usedSectors.size()) _usedSectors.resize(first + count, false);
+        std::fill_n(_usedSectors.begin() + first, count, true);
+
+        // The new copy is on disk before the header points at it. The sync also covers earlier header changes, so the
+        // sectors they released are free from here on, and the old copy is released for the next one.
+        sync();
+        const uint32_t i = slot(pos);
+        const uint32_t previous = _locations[i];
+        setLocation(i, (first << 8) | count, static_cast<uint32_t>(std::time(nullptr)));
+        if (previous) _released.push_back(previous);
+    }
+
+    void RegionFile::erase(const ChunkPos pos) {
+        std::lock_guard lock(_mtx);
+        const uint32_t i = slot(pos);
+        const uint32_t previous = _locations[i];
+        if (!previous) return;
+
+        setLocation(i, 0, 0);
+        _released.push_back(previous);
+    }
+
+    bool RegionFile::contains(const ChunkPos pos) {
+        std::lock_guard lock(_mtx);
+        return _locations[slot(pos)] != 0;
+    }
+
+    uint32_t RegionFile::allocate(const uint32_t count) const {
+        // First free run that fits, or the end of the file
+        uint32_t run = 0;
+        for (uint32_t sector = HEADER_SECTORS; sector < _usedSectors.size(); sector++) {
+            run = _usedSectors[sector] ? 0 : run + 1;
+            if (run == count) return sector + 1 - count;
+        }
+        return static_cast<uint32_t>(_usedSectors.size()) - run;
+    }
+
+    void RegionFile::setLocation(const uint32_t slot, const uint32_t location, const uint32_t timestamp) {
+        _locations[slot] = location;
+        _timestamps[slot] = timestamp;
+
+        const uint32_t locationBE = Endianness::hton(location);
+        const uint32_t timestampBE = Endianness::hton(timestamp);
+        writeAt(slot * sizeof(uint32_t), &locationBE, sizeof(locationBE));
+        writeAt((CHUNKS + slot) * sizeof(uint32_t), &timestampBE, sizeof(timestampBE));
+        std::fflush(_file);
+    }
+
+    void RegionFile::sync() {
+        std::fflush(_file);
+#if defined(_WIN32)
+        const bool synced = _commit(_fileno(_file)) == 0;
+#elif defined(__APPLE__)
+        const bool synced = fsync(fileno(_file)) == 0;
+#else
+        const bool synced = fdatasync(fileno(_file)) == 0;
+#endif
+        if (!synced) {
+            UTF8Str msg = FormatString::formatString("Could not write file: %s", _path.get());
+            Logger::crash(msg);
+        }
+
+        for (const uint32_t location : _released) std::fill_n(_usedSectors.begin() + (location >> 8), location & 0xFF, false);
+        _released.clear();
+    }
+
+    void RegionFile::writeAt(const int64_t offset, const void*__restrict__ data, const size_t len) {
+        if (std::fseek(_file, static_cast<long>(offset), SEEK_SET) || std::fwrite(data, 1, len, _file) != len) {
+            UTF8Str msg = FormatString::formatString("Could not write file: %s", _path.get());
+            Logger::crash(msg);
+        }
+    }
+
+    // RegionStorage //
+    std::shared_ptr<RegionFile> RegionStorage::region(const ChunkPos chunk) {
+        const ChunkPos pos = RegionFile::regionOf(chunk);
+        std::lock_guard lock(_mtx);
+
+        auto found = _regions.find(pos);
+        if (found != _regions.end()) {
+            found->second.lastUsed = ++_uses;
+            return found->second.file;
+        }
+
+        if (_regions.size() >= MAX_OPEN_REGIONS) {
+            // Close the least recently used region that nothing else is using. A region still held by a job has to
+            // stay here, or reopening it would give two files writing one path, so the map grows past the limit if
+            // every region is held. Copies are only made under the lock, so a use count of 1 stays 1 until then.
+            auto oldest = _regions.end();
+            for (auto it = _regions.begin(); it != _regions.end(); it++) {
+                if (it->second.file.use_count() != 1) continue;
+                if (oldest == _regions.end() || it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+            }
+            if (oldest != _regions.end()) _regions.erase(oldest);
+        }
+
+        UTF8Str path = FormatString::formatString("%sr.%d.%d.gmr", _directory.c_str(), pos.x, pos.z);
+        std::shared_ptr<RegionFile> file = std::make_shared<RegionFile>(path.get());
+        _regions.emplace(pos, OpenRegion{file, ++_uses});
+        return file;
+    }
+}
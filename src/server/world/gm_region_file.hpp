@@ -0,0 +1,105 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+
+#include <common/data/file/gm_file.hpp>
+#include <common/data/string/gm_utf8.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace game {
+    // Stores the compressed chunks of a 32x32 chunk region in one file, each in its own run of 4 KiB sectors:
+    // |====HEADER (8 KiB)==============================================|===SECTORS===|
+    // | locations (1024 x 4B) | timestamps (1024 x 4B, seconds since epoch) |    ...      |
+    // |=================================================================================|
+    // A location is the first sector << 8 | the sector count, or 0 if the chunk is not stored. Each chunk starts with
+    // its compressed length (4B) followed by the compressed data. Everything is big-endian.
+    // Rewritten chunks go to free sectors and are synced to disk before the header points at them, and sectors a chunk
+    // no longer uses are only reused once the header change is synced too, so a crash or power loss leaves either the
+    // previous or the new version of the chunk intact. Calls are thread safe.
+    class RegionFile {
+        public:
+            // Constructors
+            // Opens the region file at @p filepath, creating it if it does not exist.
+            RegionFile(const char*__restrict__ filepath);
+            ~RegionFile();
+
+            RegionFile(const RegionFile &) = delete;
+            RegionFile &operator=(const RegionFile &) = delete;
+
+            // Functions
+            // @return The compressed chunk at @p pos, or empty contents if it is not stored
+            File::FileContents read(const ChunkPos pos);
+            void write(const ChunkPos pos, const File::FileContents& compressed);
+            void erase(const ChunkPos pos);
+            bool contains(const ChunkPos pos);
+
+            static ChunkPos regionOf(const ChunkPos chunk) { return ChunkPos{chunk.x >> 5, chunk.z >> 5}; }
+
+            // Variables
+            static constexpr uint32_t CHUNKS = 32 * 32;
+            static constexpr uint32_t SECTOR_SIZE = 4096;
+            static constexpr uint32_t HEADER_SECTORS = 2;
+            static constexpr uint32_t MAX_CHUNK_SECTORS = UINT8_MAX; // Chunks must compress to under 1 MiB
+
+        private:
+            // Functions
+            static uint32_t slot(const ChunkPos pos) { return (pos.x & 31) + (pos.z & 31) * 32; }
+            // @return The first sector of a free run of @p count sectors
+            uint32_t allocate(const uint32_t count) const;
+            void setLocation(const uint32_t slot, const uint32_t location, const uint32_t timestamp);
+            void writeAt(const int64_t offset, const void*__restrict__ data, const size_t len);
+            // Flushes everything written so far to disk, then frees the sectors released before it.
+            void sync();
+
+            // Variables
+            UTF8Str _path;
+            FILE* _file = nullptr;
+            std::mutex _mtx;
+            std::array<uint32_t, CHUNKS> _locations{};
+            std::array<uint32_t, CHUNKS> _timestamps{};
+            std::vector<bool> _usedSectors; // One per sector in the file, including the header
+            std::vector<uint32_t> _released; // Locations no longer in the header, kept used until the header is synced
+    };
+
+    // The region files of a world, opened as chunks in them are read or written and closed when too many are open.
+    class RegionStorage {
+        public:
+            // Constructors
+            // @p directory holds the world, and region files go in its "region" directory.
+            RegionStorage(const std::string& directory) : _directory{directory + "/region/"} {}
+
+            RegionStorage(const RegionStorage &) = delete;
+            RegionStorage &operator=(const RegionStorage &) = delete;
+
+            // Functions
+            File::FileContents read(const ChunkPos pos) { return region(pos)->read(pos); }
+            void write(const ChunkPos pos, const File::FileContents& compressed) { region(pos)->write(pos, compressed); }
+
+            // Regions are not closed while a returned pointer to them is held, so there is one RegionFile per path.
+            std::shared_ptr<RegionFile> region(const ChunkPos chunk);
+
+            // Variables
+            static constexpr size_t MAX_OPEN_REGIONS = 64;
+
+        private:
+            // Types
+            typedef struct OpenRegion_ {
+                std::shared_ptr<RegionFile> file;
+                uint64_t lastUsed;
+            } OpenRegion;
+
+            // Variables
+            std::string _directory;
+            std::mutex _mtx;
+            std::unordered_map<ChunkPos, OpenRegion, ChunkPosHash> _regions;
+            uint64_t _uses = 0;
+    };
+}
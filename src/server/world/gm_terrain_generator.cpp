@@ -0,0 +1,157 @@
+#include "gm_terrain_generator.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace game {
+    // Eight columns per operation, lowered to AVX2 where the caller is compiled for it and to narrower SIMD elsewhere
+    typedef float32_t float32x8_t __attribute__((vector_size(8 * sizeof(float32_t))));
+    typedef int32_t int32x8_t __attribute__((vector_size(8 * sizeof(int32_t))));
+    typedef uint32_t uint32x8_t __attribute__((vector_size(8 * sizeof(uint32_t))));
+
+    static_assert(ChunkSection::SIZE % 8 == 0, "Rows of columns are split into whole vectors");
+
+    // Helpers take and return vectors through references, since passing them by value has a different ABI with and
+    // without AVX. They are always inlined, so the references cost nothing.
+
+    // Sets @p h to a well mixed hash of each lane's lattice point
+    static inline __attribute__((always_inline)) void hash(uint32x8_t& h, const int32x8_t& x, const int32x8_t& z, const uint32_t seed) {
+        h = ((uint32x8_t) x * 0x8da6b343u) ^ ((uint32x8_t) z * 0xd8163841u) ^ seed;
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        h *= 0x297a2d39u;
+        h ^= h >> 15;
+    }
+
+    // Sets @p n to the dot product of the offset (@p x, @p z) with one of the four diagonal gradients picked by the hash
+    // of @p cellX, @p cellZ
+    static inline __attribute__((always_inline)) void gradient(float32x8_t& n, const int32x8_t& cellX, const int32x8_t& cellZ,
+        const uint32_t seed, const float32x8_t& x, const float32x8_t& z
+    ) {
+        uint32x8_t h;
+        hash(h, cellX, cellZ, seed);
+
+        // Flipping the sign bit negates exactly, without a branch or a multiply. Casts between vector types keep the bits.
+        const uint32x8_t xBits = (uint32x8_t) x ^ ((h & 1u) << 31);
+        const uint32x8_t zBits = (uint32x8_t) z ^ ((h & 2u) << 30);
+        n = (float32x8_t) xBits + (float32x8_t) zBits;
+    }
+
+    // Fills @p heights for one chunk. Inlined into each path below, so each is compiled for its own instruction set.
+    static inline __attribute__((always_inline)) void heightsKernel(const int32_t blockX, const int32_t blockZ,
+        const uint32_t seed, int32_t*__restrict__ heights
+    ) {
+        for (uint32_t z = 0; z < ChunkSection::SIZE; z++) {
+            for (uint32_t x = 0; x < ChunkSection::SIZE; x += 8) {
+                const int32x8_t columnX = int32x8_t{0, 1, 2, 3, 4, 5, 6, 7} + static_cast<int32_t>(blockX + x);
+                const int32x8_t columnZ = int32x8_t{} + static_cast<int32_t>(blockZ + z);
+
+                float32x8_t total = float32x8_t{} + static_cast<float32_t>(TerrainGenerator::BASE_HEIGHT);
+                float32_t amplitude = TerrainGenerator::LARGEST_AMPLITUDE;
+                for (uint32_t octave = 0; octave < TerrainGenerator::OCTAVES; octave++) {
+                    // Splitting block coordinates into a lattice cell and a power of two fraction is exact
+                    const uint32_t shift = TerrainGenerator::LARGEST_PERIOD_SHIFT - octave;
+                    const int32_t mask = (1 << shift) - 1;
+                    const float32_t scale = 1.f / static_cast<float32_t>(1 << shift);
+                    const int32x8_t cellX = columnX >> static_cast<int32_t>(shift);
+                    const int32x8_t cellZ = columnZ >> static_cast<int32_t>(shift);
+                    const float32x8_t fx = __builtin_convertvector(columnX & mask, float32x8_t) * scale;
+                    const float32x8_t fz = __builtin_convertvector(columnZ & mask, float32x8_t) * scale;
+
+                    const uint32_t octaveSeed = seed + octave * 0x9E3779B9u;
+                    const int32x8_t nextX = cellX + 1;
+                    const int32x8_t nextZ = cellZ + 1;
+                    const float32x8_t gx = fx - 1.f;
+                    const float32x8_t gz = fz - 1.f;
+                    float32x8_t n00, n10, n01, n11;
+                    gradient(n00, cellX, cellZ, octaveSeed, fx, fz);
+                    gradient(n10, nextX, cellZ, octaveSeed, gx, fz);
+                    gradient(n01, cellX, nextZ, octaveSeed, fx, gz);
+                    gradient(n11, nextX, nextZ, octaveSeed, gx, gz);
+
+                    // Quintic fade, so the surface has no creases along cell edges
+                    const float32x8_t u = fx * fx * fx * (fx * (fx * 6.f - 15.f) + 10.f);
+                    const float32x8_t v = fz * fz * fz * (fz * (fz * 6.f - 15.f) + 10.f);
+                    const float32x8_t nx0 = n00 + u * (n10 - n00);
+                    const float32x8_t nx1 = n01 + u * (n11 - n01);
+                    total += (nx0 + v * (nx1 - nx0)) * amplitude;
+                    amplitude *= .5f;
+                }
+
+                // Heights stay well above zero, so truncating floors them
+                const int32x8_t height = __builtin_convertvector(total, int32x8_t);
+                std::memcpy(heights + z * ChunkSection::SIZE + x, &height, sizeof(height));
+            }
+        }
+    }
+
+    static void heightsPortable(const int32_t blockX, const int32_t blockZ, const uint32_t seed, int32_t*__restrict__ heights) {
+        heightsKernel(blockX, blockZ, seed, heights);
+    }
+
+    #if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2")))
+    static void heightsAVX2(const int32_t blockX, const int32_t blockZ, const uint32_t seed, int32_t*__restrict__ heights) {
+        heightsKernel(blockX, blockZ, seed, heights);
+    }
+    #endif
+
+    void TerrainGenerator::heights(const ChunkPos pos, int32_t*__restrict__ heights, const bool vectorised) const {
+        const int32_t blockX = pos.x * static_cast<int32_t>(ChunkSection::SIZE);
+        const int32_t blockZ = pos.z * static_cast<int32_t>(ChunkSection::SIZE);
+        const uint32_t seed = static_cast<uint32_t>(_seed ^ (_seed >> 32));
+
+        #if defined(__x86_64__) || defined(__i386__)
+        static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+        if (vectorised && hasAVX2) {
+            heightsAVX2(blockX, blockZ, seed, heights);
+            return;
+        }
+        #endif
+        heightsPortable(blockX, blockZ, seed, heights);
+    }
+
+    std::unique_ptr<Chunk> TerrainGenerator::generate(const ChunkPos pos) const {
+        std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(pos);
+
+        std::array<int32_t, ChunkSection::SIZE * ChunkSection::SIZE> columns;
+        heights(pos, columns.data());
+        int32_t top = SEA_LEVEL, bottom = static_cast<int32_t>(Chunk::HEIGHT);
+        for (int32_t& height : columns) {
+            height = std::clamp(height, 1, static_cast<int32_t>(Chunk::HEIGHT) - 1);
+            top = std::max(top, height);
+            bottom = std::min(bottom, height);
+        }
+
+        // Sections under every column's surface layers are solid stone
+        std::array<BlockID, ChunkSection::VOLUME> blocks;
+        for (uint32_t section = 0; section <= static_cast<uint32_t>(top) / ChunkSection::SIZE; section++) {
+            const int32_t sectionTop = static_cast<int32_t>((section + 1) * ChunkSection::SIZE) - 1;
+            if (section > 0 && sectionTop < bottom - 3) {
+                std::unique_ptr<ChunkSection> stone = std::make_unique<ChunkSection>();
+                stone->fill(Blocks::STONE);
+                chunk->setSection(section, std::move(stone));
+                continue;
+            }
+
+            // Otherwise fill it a block at a time, then pack it once
+            for (uint32_t i = 0; i < ChunkSection::VOLUME; i++) {
+                const int32_t y = static_cast<int32_t>(section * ChunkSection::SIZE + (i >> 8));
+                const int32_t height = columns[i & 0xFF]; // index() puts z * 16 + x in the low bits
+                const bool beach = height <= SEA_LEVEL + 1;
+
+                BlockID block = Blocks::AIR;
+                if (y == 0) block = Blocks::BEDROCK;
+                else if (y < height - 3) block = Blocks::STONE;
+                else if (y < height) block = beach ? Blocks::SAND : Blocks::DIRT;
+                else if (y == height) block = beach ? Blocks::SAND : Blocks::GRASS;
+                else if (y <= SEA_LEVEL) block = Blocks::WATER;
+                blocks[i] = block;
+            }
+            chunk->setSection(section, std::make_unique<ChunkSection>(blocks.data()));
+        }
+
+        return chunk;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gm_chunk.hpp"
+
+#include <common/headers/float.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace game {
+    // Builds the terrain of chunks that have never been saved, from a heightmap of gradient noise summed over OCTAVES.
+    // Generation only depends on the seed and the chunk position, so any number of chunks can be generated at once on
+    // different threads and a seed always makes the same world.
+    //
+    // Noise is evaluated for eight columns at a time with GCC vector extensions, using AVX2 when the CPU has it. Every
+    // code path does the same single-precision operations in the same order without fusing any, and lattice positions
+    // come from integer block coordinates, so results match bit for bit on every machine and path.
+    class TerrainGenerator {
+        public:
+            // Constructors
+            TerrainGenerator(const uint64_t seed) : _seed{seed} {}
+
+            // Functions
+            std::unique_ptr<Chunk> generate(const ChunkPos pos) const;
+
+            // Heights of the top solid block of every column in the chunk at @p pos, indexed by z * 16 + x.
+            // @p vectorised uses AVX2 if the CPU has it, otherwise the portable path, which gives the same result.
+            void heights(const ChunkPos pos, int32_t*__restrict__ heights, const bool vectorised) const;
+            void heights(const ChunkPos pos, int32_t*__restrict__ heights) const { this->heights(pos, heights, true); }
+
+            uint64_t seed() const { return _seed; }
+
+            // Variables
+            static constexpr int32_t BASE_HEIGHT = 64;
+            static constexpr int32_t SEA_LEVEL = 62;
+            static constexpr uint32_t OCTAVES = 5;
+            static constexpr uint32_t LARGEST_PERIOD_SHIFT = 8; // The first octave repeats every 2^8 blocks, each after that every half as many
+            static constexpr float32_t LARGEST_AMPLITUDE = 32.f; // Blocks above or below BASE_HEIGHT, halving each octave
+
+        private:
+            // Variables
+            uint64_t _seed;
+    };
+}
@@ -0,0 +1,136 @@
+#include "gm_terrain_query.hpp"
+
+#include <common/system/gm_jobs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace game {
+    bool TerrainQuery::raycast(const glm::dvec3& origin, const glm::dvec3& direction, const float64_t maxDistance,
+        VoxelHit& hit
+    ) {
+        hit.hit = false;
+        const float64_t length = glm::length(direction);
+        if (length == 0.) return false;
+        const glm::dvec3 dir = direction / length;
+
+        glm::ivec3 cell{
+            static_cast<int32_t>(std::floor(origin.x)), static_cast<int32_t>(std::floor(origin.y)),
+            static_cast<int32_t>(std::floor(origin.z))
+        };
+        BlockID id = block(cell.x, cell.y, cell.z);
+        if (Blocks::info(id).solid) {
+            hit = VoxelHit{cell, glm::ivec3{0, 0, 0}, 0., id, true};
+            return true;
+        }
+
+        // Distance along the ray to the next face crossing on each axis, and between crossings
+        int32_t step[3];
+        float64_t next[3], delta[3];
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            if (dir[axis] > 0.) {
+                step[axis] = 1;
+                next[axis] = (cell[axis] + 1. - origin[axis]) / dir[axis];
+                delta[axis] = 1. / dir[axis];
+            } else if (dir[axis] < 0.) {
+                step[axis] = -1;
+                next[axis] = (origin[axis] - cell[axis]) / -dir[axis];
+                delta[axis] = -1. / dir[axis];
+            } else {
+                step[axis] = 0;
+                next[axis] = std::numeric_limits<float64_t>::infinity();
+                delta[axis] = std::numeric_limits<float64_t>::infinity();
+            }
+        }
+
+        while (true) {
+            const uint32_t axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+            const float64_t distance = next[axis];
+            if (distance > maxDistance) return false;
+
+            cell[axis] += step[axis];
+            next[axis] += delta[axis];
+
+            // Nothing is solid outside the world, so a ray leaving it will not hit anything more
+            if ((cell.y < 0 && step[1] <= 0) || (cell.y >= static_cast<int32_t>(Chunk::HEIGHT) && step[1] >= 0)) return false;
+
+            id = block(cell.x, cell.y, cell.z);
+            if (!Blocks::info(id).solid) continue;
+
+            glm::ivec3 normal{0, 0, 0};
+            normal[axis] = -step[axis];
+            hit = VoxelHit{cell, normal, distance, id, true};
+            return true;
+        }
+    }
+
+    uint8_t TerrainQuery::sweep(glm::dvec3& min, glm::dvec3& max, glm::dvec3& motion) {
+        uint8_t blocked = 0;
+        for (const uint32_t axis : {1u, 0u, 2u}) {
+            const float64_t moved = sweepAxis(min, max, axis, motion[axis]);
+            if (moved != motion[axis]) blocked |= static_cast<uint8_t>(1 << axis);
+            motion[axis] = moved;
+        }
+        return blocked;
+    }
+
+    float64_t TerrainQuery::sweepAxis(glm::dvec3& min, glm::dvec3& max, const uint32_t axis, const float64_t distance) {
+        if (distance == 0.) return 0.;
+
+        // Blocks the box covers across the other two axes
+        const uint32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
+        const int32_t uMin = static_cast<int32_t>(std::floor(min[u])), uMax = static_cast<int32_t>(std::ceil(max[u])) - 1;
+        const int32_t vMin = static_cast<int32_t>(std::floor(min[v])), vMax = static_cast<int32_t>(std::ceil(max[v])) - 1;
+        auto layerSolid = [&](const int32_t layer) {
+            int32_t at[3];
+            at[axis] = layer;
+            for (at[u] = uMin; at[u] <= uMax; at[u]++) {
+                for (at[v] = vMin; at[v] <= vMax; at[v]++) {
+                    if (solid(at[0], at[1], at[2])) return true;
+                }
+            }
+            return false;
+        };
+
+        // Visit the layers of blocks the leading face enters, nearest first
+        float64_t moved = distance;
+        if (distance > 0.) {
+            const int32_t first = static_cast<int32_t>(std::ceil(max[axis]));
+            const int32_t last = static_cast<int32_t>(std::ceil(max[axis] + distance)) - 1;
+            for (int32_t layer = first; layer <= last; layer++) {
+                if (!layerSolid(layer)) continue;
+                moved = std::max(0., layer - max[axis] - SKIN);
+                break;
+            }
+        } else {
+            const int32_t first = static_cast<int32_t>(std::floor(min[axis])) - 1;
+            const int32_t last = static_cast<int32_t>(std::floor(min[axis] + distance));
+            for (int32_t layer = first; layer >= last; layer--) {
+                if (!layerSolid(layer)) continue;
+                moved = std::min(0., layer + 1. - min[axis] + SKIN);
+                break;
+            }
+        }
+
+        min[axis] += moved;
+        max[axis] += moved;
+        return moved;
+    }
+
+    void TerrainQuery::raycast(const ChunkMap& chunks, const VoxelRay* rays, VoxelHit* hits, const size_t count) {
+        Jobs::parallelFor(count, QUERY_GRAIN, [&](const size_t begin, const size_t end) {
+            TerrainQuery query{chunks};
+            for (size_t i = begin; i < end; i++) query.raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+        });
+    }
+
+    void TerrainQuery::sweep(const ChunkMap& chunks, glm::dvec3* mins, glm::dvec3* maxs, glm::dvec3* motions,
+        uint8_t* blocked, const size_t count
+    ) {
+        Jobs::parallelFor(count, QUERY_GRAIN, [&](const size_t begin, const size_t end) {
+            TerrainQuery query{chunks};
+            for (size_t i = begin; i < end; i++) blocked[i] = query.sweep(mins[i], maxs[i], motions[i]);
+        });
+    }
+}
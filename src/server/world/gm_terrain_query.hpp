@@ -0,0 +1,91 @@
+#pragma once
+
+#include "gm_block.hpp"
+#include "gm_chunk.hpp"
+#include "gm_chunk_map.hpp"
+
+#include <common/headers/float.hpp>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace game {
+    typedef struct VoxelRay_ {
+        glm::dvec3 origin;
+        glm::dvec3 direction; // Need not be normalised
+        float64_t maxDistance;
+    } VoxelRay;
+
+    typedef struct VoxelHit_ {
+        glm::ivec3 block; // World coordinates of the solid block hit
+        glm::ivec3 normal; // Face the ray entered through, or zero if it started inside the block
+        float64_t distance; // Along the normalised direction
+        BlockID id;
+        bool hit;
+    } VoxelHit;
+
+    // Collision queries against the solid blocks of loaded chunks, for movers that travel through the terrain.
+    // Blocks are read straight from chunk sections, and the chunk last looked up is kept, so the neighbouring blocks
+    // that a ray or box visits cost an array index instead of a hash lookup. A query holds pointers into the chunk map,
+    // so it must not outlive a tick in which chunks are loaded or unloaded. Unloaded chunks and heights outside the
+    // world are air.
+    class TerrainQuery {
+        public:
+            // Constructors
+            TerrainQuery(const ChunkMap& chunks) : _chunks{chunks} {}
+
+            // Functions
+            BlockID block(const int32_t x, const int32_t y, const int32_t z) {
+                if (y < 0 || y >= static_cast<int32_t>(Chunk::HEIGHT)) return Blocks::AIR;
+                const ChunkPos pos = ChunkPos::fromBlock(x, z);
+                if (!_cached || !(pos == _chunkPos)) {
+                    _chunk = _chunks.find(pos);
+                    _chunkPos = pos;
+                    _cached = true;
+                }
+                if (!_chunk) return Blocks::AIR;
+
+                const ChunkSection* section = _chunk->section(y / ChunkSection::SIZE);
+                return section ? section->get(x & 15, y % ChunkSection::SIZE, z & 15) : Blocks::AIR;
+            }
+            bool solid(const int32_t x, const int32_t y, const int32_t z) { return Blocks::info(block(x, y, z)).solid; }
+
+            // Walks the blocks along a ray one face crossing at a time (Amanatides and Woo), up to @p maxDistance
+            // along the normalised @p direction.
+            // @return True if a solid block was hit, which is described in @p hit
+            bool raycast(const glm::dvec3& origin, const glm::dvec3& direction, const float64_t maxDistance, VoxelHit& hit);
+
+            // Moves the box [@p min, @p max] by as much of @p motion as it can before touching a solid block, one axis at
+            // a time: y first, so a box landing on the ground does not catch on it while moving sideways, then x and z.
+            // Only blocks entered on the way are checked, so a box already inside a block is not stopped by it.
+            // @p motion is left holding the motion actually made.
+            // @return A bit per axis whose motion was cut short
+            uint8_t sweep(glm::dvec3& min, glm::dvec3& max, glm::dvec3& motion);
+
+            // raycast() for each of @p count rays, spread over Jobs.
+            static void raycast(const ChunkMap& chunks, const VoxelRay* rays, VoxelHit* hits, const size_t count);
+            // sweep() for each of @p count boxes, spread over Jobs.
+            static void sweep(const ChunkMap& chunks, glm::dvec3* mins, glm::dvec3* maxs, glm::dvec3* motions,
+                uint8_t* blocked, const size_t count);
+
+            // Variables
+            static constexpr size_t QUERY_GRAIN = 64; // Queries per job, sharing the job's chunk cache
+            static constexpr float64_t SKIN = 1e-7; // Gap kept between a swept box and the block it stops at
+
+        private:
+            // Functions
+            // Moves the box along @p axis by up to @p distance.
+            // @return The distance moved
+            float64_t sweepAxis(glm::dvec3& min, glm::dvec3& max, const uint32_t axis, const float64_t distance);
+
+            // Variables
+            const ChunkMap& _chunks;
+            const Chunk* _chunk = nullptr; // Last chunk looked up, or nullptr if it is not loaded
+            ChunkPos _chunkPos{0, 0};
+            bool _cached = false;
+    };
+}
@@ -0,0 +1,40 @@
+#include "gm_tick_wheel.hpp"
+
+#include <algorithm>
+
+namespace game {
+    bool TickWheel::schedule(const int32_t x, const int32_t y, const int32_t z, const uint64_t delay) {
+        if (!_scheduled.insert(key(x, y, z)).second) return false;
+
+        // The next advance() is the first tick of the delay
+        insert(ScheduledTick{x, y, z, _now + std::clamp(delay, static_cast<uint64_t>(1), MAX_DELAY) - 1});
+        return true;
+    }
+
+    void TickWheel::advance(std::vector<ScheduledTick>& due) {
+        // Each level whose lower levels all wrapped around starts a new slot, whose ticks now fit a level lower.
+        // Higher levels go first, since what they bring down may need bringing down again.
+        uint32_t wrapped = 1;
+        while (wrapped < LEVELS && !(_now & ((static_cast<uint64_t>(1) << (SLOT_BITS * wrapped)) - 1))) wrapped++;
+        for (uint32_t level = wrapped - 1; level > 0; level--) {
+            std::vector<ScheduledTick> moving;
+            moving.swap(_levels[level][(_now >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+            for (const ScheduledTick& tick : moving) insert(tick);
+        }
+
+        std::vector<ScheduledTick>& slot = _levels[0][_now & (SLOTS - 1)];
+        for (const ScheduledTick& tick : slot) {
+            _scheduled.erase(key(tick.x, tick.y, tick.z));
+            due.push_back(tick);
+        }
+        slot.clear();
+        _now++;
+    }
+
+    void TickWheel::insert(const ScheduledTick& tick) {
+        // The lowest level whose current turn the tick falls in
+        uint32_t level = 0;
+        while (level < LEVELS - 1 && (tick.due >> (SLOT_BITS * (level + 1))) != (_now >> (SLOT_BITS * (level + 1)))) level++;
+        _levels[level][(tick.due >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(tick);
+    }
+}
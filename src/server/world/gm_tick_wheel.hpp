@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace game {
+    typedef struct ScheduledTick_ {
+        int32_t x;
+        int32_t y;
+        int32_t z;
+        uint64_t due; // Tick the block is ticked on
+    } ScheduledTick;
+
+    // Block ticks waiting to be due, in a hierarchical timing wheel. Each level is a ring of SLOTS slots, and a slot of
+    // one level spans a whole turn of the level below it, so LEVELS levels cover SLOTS^LEVELS ticks. Ticks wait in the
+    // lowest level whose turn they fall in, and move down a level each time the wheel below wraps around to their
+    // slot. Scheduling and advancing cost the same however many ticks are waiting, and ticks due far ahead are only
+    // touched LEVELS times before they run.
+    // A block has at most one tick waiting, so blocks rescheduling themselves each tick do not pile up.
+    class TickWheel {
+        public:
+            // Constructors
+            TickWheel() {}
+
+            TickWheel(const TickWheel &) = delete;
+            TickWheel &operator=(const TickWheel &) = delete;
+
+            // Functions
+            // Schedules the block at world coordinates to tick in @p delay ticks, which is at least 1 and at most
+            // MAX_DELAY. Nothing happens if the block already has a tick waiting.
+            // @return False if the block already had a tick waiting
+            bool schedule(const int32_t x, const int32_t y, const int32_t z, const uint64_t delay);
+            // Moves to the next tick, adding the ticks due on it to @p due.
+            void advance(std::vector<ScheduledTick>& due);
+
+            // @return The tick advance() runs next
+            uint64_t now() const { return _now; }
+            size_t size() const { return _scheduled.size(); }
+
+            // Variables
+            static constexpr uint32_t SLOT_BITS = 6;
+            static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+            static constexpr uint32_t LEVELS = 4;
+            static constexpr uint64_t MAX_DELAY = (static_cast<uint64_t>(1) << (SLOT_BITS * LEVELS)) - 1;
+
+        private:
+            // Functions
+            void insert(const ScheduledTick& tick);
+            // @return A key for the block at world coordinates, for y within the world and x and z within 2^25 blocks
+            //         of the origin
+            static uint64_t key(const int32_t x, const int32_t y, const int32_t z) {
+                return (static_cast<uint64_t>(static_cast<uint32_t>(x) & 0x3ffffff) << 38) |
+                    (static_cast<uint64_t>(static_cast<uint32_t>(z) & 0x3ffffff) << 12) | (static_cast<uint32_t>(y) & 0xfff);
+            }
+
+            // Variables
+            std::array<std::array<std::vector<ScheduledTick>, SLOTS>, LEVELS> _levels;
+            std::unordered_set<uint64_t> _scheduled; // Keys of the blocks with a tick waiting
+            uint64_t _now = 0;
+    };
+}
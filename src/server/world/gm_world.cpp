@@ -1,32 +1,340 @@
 #include "gm_world.hpp"
 
+#include "gm_chunk_serializer.hpp"
+#include "gm_entity_serializer.hpp"
+
+#include <common/data/bkv/gm_bkv_builder.hpp>
+#include <common/data/bkv/gm_bkv_reader.hpp>
+#include <common/data/file/gm_compression.hpp>
 #include <common/data/file/gm_logger.hpp>
+#include <common/headers/string.hpp>
+#include <common/system/gm_profiler.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <functional>
+#include <random>
+#include <stdexcept>
 #include <thread>
 
+namespace fs = std::filesystem;
+
 namespace game {
     World::World(EntityPool& entityPool) : _entityPool{entityPool} {
-        
+        _serverComponents.physics().setTerrain(&_chunks);
     }
     
     World::~World() {
         // Save & quit
+        _loader.reset();
+        save();
     }
 
     void World::load(const std::string& world) {
-        // Load
+        _loader.reset();
+        if (_regions) save();
+
+        UTF8Str msg = FormatString::formatString("Loading world: %s", world.c_str());
+        Logger::log(LOG_INFO, msg);
+        _directory = WORLD_DIRECTORY + world;
+        _regions = std::make_unique<RegionStorage>(_directory);
+        _generator = std::make_unique<TerrainGenerator>(loadSeed());
+        _loader = std::make_unique<ChunkLoader>(*_regions, *_generator);
+        _playersChanged = !_players.empty();
+        loadEntities();
     }
 
     void World::update() {
+        PROFILE_ZONE("World::update");
+
         // Update entities
         _serverComponents.update();
+        TransformPool& transforms = _serverComponents.transform();
+        if (transforms.anyDirty() || transforms.size() != _savedEntities) _entitiesChanged = true;
 
-        // Update world
-        // TODO
+        // Update world, then relight what changed and what was loaded
+        updateChunks();
+        tickBlocks();
+        _light.update();
+
+        // Autosave once the previous save is written, so saves never queue up behind a slow disk
+        finishSave();
+        if (++_ticks >= _nextAutosave && startSave()) _nextAutosave = _ticks + AUTOSAVE_INTERVAL;
     }
 
     void World::save() {
-        // Save
+        if (!_regions) return;
+
+        if (_saving) Jobs::wait(_saving->done);
+        finishSave();
+        startSave();
+        Jobs::wait(_saving->done);
+        finishSave();
+    }
+
+    bool World::startSave() {
+        if (!_regions || _saving) return false;
+        PROFILE_ZONE("World::startSave");
+
+        // Snapshot at the tick boundary, which only shares sections and copies transforms
+        std::shared_ptr<SaveBatch> batch = std::make_shared<SaveBatch>();
+        for (const auto& [pos, chunk] : _chunks) {
+            if (!chunk->dirty()) continue;
+            batch->chunks.push_back(chunk->snapshot());
+            chunk->setDirty(false);
+        }
+        for (const auto& unloaded : _unloaded) {
+            batch->unloaded.push_back(unloaded);
+            batch->chunks.push_back(unloaded.second);
+        }
+
+        // Then encode, compress and write them on the workers
+        std::vector<JobHandle> jobs;
+        RegionStorage* regions = _regions.get();
+        for (size_t begin = 0; begin < batch->chunks.size(); begin += SAVE_GRAIN) {
+            const size_t end = std::min(begin + SAVE_GRAIN, batch->chunks.size());
+            jobs.push_back(Jobs::submit([regions, batch, begin, end] {
+                for (size_t i = begin; i < end; i++) {
+                    const Chunk& chunk = *batch->chunks[i];
+                    try {
+                        regions->write(chunk.pos(), ChunkSerializer::compress(ChunkSerializer::encode(chunk)));
+                    } catch (std::exception& e) {
+                        UTF8Str msg = FormatString::formatString("Could not save chunk %d, %d: %s", chunk.pos().x, chunk.pos().z, e.what());
+                        Logger::log(LOG_ERR, msg);
+                        std::lock_guard lock(batch->mtx);
+                        batch->failed.push_back(chunk.pos());
+                    }
+                }
+            }));
+        }
+
+        if (_entitiesChanged) {
+            TransformPool& transforms = _serverComponents.transform();
+            std::shared_ptr<const EntitySnapshot> entities = std::make_shared<EntitySnapshot>(EntitySerializer::snapshot(transforms));
+            _savedEntities = transforms.size();
+            _entitiesChanged = false;
+
+            jobs.push_back(Jobs::submit([path = _directory + ENTITIES_FILE, batch, entities] {
+                try {
+                    const BKV_t bkv = EntitySerializer::encode(*entities);
+                    Compression::compressFile(path.c_str(), File::FileContents{static_cast<size_t>(bkv.size()), bkv.data()},
+                        Compression::CODEC_LZ4);
+                } catch (std::exception& e) {
+                    UTF8Str msg = FormatString::formatString("Could not save entities: %s", e.what());
+                    Logger::log(LOG_ERR, msg);
+                    batch->entitiesFailed = true; // Only read once the batch is done
+                }
+            }));
+        }
+
+        batch->done = Jobs::submit([] {}, jobs);
+        _saving = std::move(batch);
+        return true;
+    }
+
+    void World::finishSave() {
+        if (!_saving || !_saving->done->done()) return;
+
+        // Chunks that failed are written again by the next save
+        const std::vector<ChunkPos>& failed = _saving->failed;
+        for (const ChunkPos pos : failed) {
+            if (Chunk* chunk = _chunks.find(pos)) chunk->setDirty(true);
+        }
+        for (const auto& [pos, chunk] : _saving->unloaded) {
+            if (std::find(failed.begin(), failed.end(), pos) != failed.end()) continue;
+            const auto found = _unloaded.find(pos);
+            if (found != _unloaded.end() && found->second == chunk) _unloaded.erase(found);
+        }
+        if (_saving->entitiesFailed) _entitiesChanged = true;
+
+        _saving.reset();
+    }
+
+    uint64_t World::loadSeed() {
+        const std::string path = _directory + LEVEL_FILE;
+        if (fs::exists(path)) {
+            const File::FileContents contents = File::readFile(path.c_str());
+            const BKV_t bkv{static_cast<int64_t>(contents.length()), std::shared_ptr<const uint8_t>(contents.get(), [contents](const uint8_t*) {})};
+            const BKV_Reader reader(bkv);
+            if (!reader.contains("seed")) {
+                UTF8Str msg = FormatString::formatString("World has no seed: %s", path.c_str());
+                Logger::crash(msg);
+            }
+            return reader.getInt<uint64_t>("seed", 0);
+        }
+
+        std::random_device device;
+        const uint64_t seed = (static_cast<uint64_t>(device()) << 32) ^ device() ^
+            static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+
+        BKV_Builder builder;
+        builder.setInt<uint64_t>("seed", seed);
+        const BKV_t bkv = builder.build();
+        fs::create_directories(_directory);
+        File::writeFile(path.c_str(), File::FileContents{static_cast<size_t>(bkv.size()), bkv.data()});
+
+        UTF8Str msg = FormatString::formatString("Created world with seed %lu.", seed);
+        Logger::log(LOG_INFO, msg);
+        return seed;
+    }
+
+    void World::loadEntities() {
+        const std::string path = _directory + ENTITIES_FILE;
+        if (!fs::exists(path)) return;
+
+        try {
+            const File::FileContents contents = Compression::decompressFile(path.c_str());
+            const BKV_t bkv{static_cast<int64_t>(contents.length()), std::shared_ptr<const uint8_t>(contents.get(), [contents](const uint8_t*) {})};
+            const size_t count = EntitySerializer::decode(bkv, _entityPool, _serverComponents.transform());
+
+            UTF8Str msg = FormatString::formatString("Loaded %lu entities.", count);
+            Logger::log(LOG_INFO, msg);
+        } catch (std::exception& e) {
+            UTF8Str msg = FormatString::formatString("Could not load entities: %s", e.what());
+            Logger::log(LOG_ERR, msg);
+        }
+
+        // The next tick clears dirty bits before it propagates, so world transforms of loaded children are
+        // worked out now
+        _serverComponents.transform().propagate();
+
+        // Freshly loaded entities match what is saved
+        _savedEntities = _serverComponents.transform().size();
+        _entitiesChanged = false;
+    }
+
+    void World::setPlayerChunks(std::vector<ChunkPos>&& players) {
+        _players = std::move(players);
+        _playersChanged = true;
+    }
+
+    void World::updateChunks() {
+        if (!_loader) return;
+        PROFILE_ZONE("World::updateChunks");
+
+        const int64_t unloadDistance = static_cast<int64_t>(UNLOAD_DISTANCE) * UNLOAD_DISTANCE;
+        if (_playersChanged) {
+            _playersChanged = false;
+            _loader->setPlayers(_players);
+
+            // Drop what players moved away from, which is everything once no players are left
+            std::vector<ChunkPos> far;
+            for (const auto& [pos, chunk] : _chunks) if (_loader->distance(pos) > unloadDistance) far.push_back(pos);
+            for (const ChunkPos pos : far) unloadChunk(pos);
+            _loader->cancelBeyond(static_cast<int64_t>(VIEW_DISTANCE) * VIEW_DISTANCE);
+
+            // Then request what they moved towards
+            for (const ChunkPos player : _players) {
+                for (int32_t dz = -VIEW_DISTANCE; dz <= VIEW_DISTANCE; dz++) {
+                    for (int32_t dx = -VIEW_DISTANCE; dx <= VIEW_DISTANCE; dx++) {
+                        if (dx * dx + dz * dz > VIEW_DISTANCE * VIEW_DISTANCE) continue;
+                        const ChunkPos pos{player.x + dx, player.z + dz};
+                        if (!_chunks.find(pos) && !restoreUnloaded(pos)) _loader->request(pos);
+                    }
+                }
+            }
+        }
+
+        // Loads that finished after players moved away are dropped rather than added just to be unloaded again
+        for (std::unique_ptr<Chunk>& chunk : _loader->takeReady(MAX_CHUNKS_PER_TICK)) {
+            if (_chunks.find(chunk->pos()) || _loader->distance(chunk->pos()) > unloadDistance) continue;
+            _light.chunkAdded(chunk->pos());
+            _chunks.insert(std::move(chunk));
+        }
+
+        _loader->dispatch();
+    }
+
+    void World::tickBlocks() {
+        PROFILE_ZONE("World::tickBlocks");
+
+        _dueTicks.clear();
+        _blockTicks.advance(_dueTicks);
+        for (const ScheduledTick& tick : _dueTicks) {
+            if (!_chunks.find(ChunkPos::fromBlock(tick.x, tick.z))) continue;
+            const BlockTick run = Blocks::info(getBlock(tick.x, tick.y, tick.z)).tick;
+            if (run) run(*this, tick.x, tick.y, tick.z);
+        }
+
+        // Pick every random tick before running any, since ticks may load or unload chunks
+        _dueTicks.clear();
+        for (const auto& [pos, chunk] : _chunks) {
+            for (uint32_t index = 0; index < Chunk::SECTIONS; index++) {
+                const ChunkSection* section = chunk->section(index);
+                if (!section || !section->randomTickCount()) continue;
+
+                for (uint32_t i = 0; i < RANDOM_TICKS_PER_SECTION; i++) {
+                    const uint32_t block = _random() % ChunkSection::VOLUME;
+                    if (!Blocks::info(section->get(block)).randomTick) continue;
+                    _dueTicks.push_back(ScheduledTick{
+                        pos.x * 16 + static_cast<int32_t>(block & 15),
+                        static_cast<int32_t>(index * ChunkSection::SIZE + (block >> 8)),
+                        pos.z * 16 + static_cast<int32_t>((block >> 4) & 15),
+                        _blockTicks.now()
+                    });
+                }
+            }
+        }
+
+        // Earlier ticks may have changed the block since it was picked
+        for (const ScheduledTick& tick : _dueTicks) {
+            const BlockTick run = Blocks::info(getBlock(tick.x, tick.y, tick.z)).randomTick;
+            if (run) run(*this, tick.x, tick.y, tick.z);
+        }
+    }
+
+    bool World::restoreUnloaded(const ChunkPos pos) {
+        const auto found = _unloaded.find(pos);
+        if (found == _unloaded.end()) return false;
+
+        // Unloaded chunks that have not been written yet are newer than the region file
+        std::unique_ptr<Chunk> chunk = found->second->snapshot();
+        chunk->setDirty(true);
+        LightEngine::lightChunk(*chunk); // Snapshots do not keep light
+        _chunks.insert(std::move(chunk));
+        _light.chunkAdded(pos);
+        _unloaded.erase(found);
+        return true;
+    }
+
+    bool World::loadChunk(const ChunkPos pos) {
+        // Reading it again would replace the loaded chunk, and any changes not yet saved, with the saved copy
+        if (_chunks.find(pos)) return true;
+        if (_loader) _loader->cancel(pos);
+        if (restoreUnloaded(pos)) return true;
+        if (!_regions) return false;
+
+        try {
+            const File::FileContents compressed = _regions->read(pos);
+            if (!compressed.length()) return false;
+            std::unique_ptr<Chunk> chunk = ChunkSerializer::decode(ChunkSerializer::decompress(compressed));
+            if (!(chunk->pos() == pos)) {
+                UTF8Str msg = FormatString::formatString("Stored as chunk %d, %d.", chunk->pos().x, chunk->pos().z);
+                throw std::runtime_error(msg.get());
+            }
+            chunk->setDirty(false);
+            LightEngine::lightChunk(*chunk);
+            _light.chunkAdded(chunk->pos());
+            _chunks.insert(std::move(chunk));
+            return true;
+        } catch (std::runtime_error& e) {
+            UTF8Str msg = FormatString::formatString("Could not load chunk %d, %d: %s", pos.x, pos.z, e.what());
+            Logger::log(LOG_ERR, msg);
+            return false;
+        }
+    }
+
+    bool World::setBlock(const int32_t x, const int32_t y, const int32_t z, const BlockID block) {
+        const BlockID previous = _chunks.getBlock(x, y, z);
+        if (!_chunks.setBlock(x, y, z, block)) return false;
+        if (previous != block) _light.blockChanged(x, y, z);
+        return true;
+    }
+
+    void World::unloadChunk(const ChunkPos pos) {
+        std::unique_ptr<Chunk> chunk = _chunks.erase(pos);
+        // Chunks the current save is writing are kept too, so they are not read back before the write lands
+        if (chunk && (chunk->dirty() || _saving) && _regions) _unloaded[pos] = std::move(chunk);
     }
 }
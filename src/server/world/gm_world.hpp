@@ -1,8 +1,23 @@
 #pragma once
 
+#include "gm_chunk_loader.hpp"
+#include "gm_chunk_map.hpp"
+#include "gm_light_engine.hpp"
+#include "gm_region_file.hpp"
+#include "gm_terrain_generator.hpp"
+#include "gm_tick_wheel.hpp"
 #include "../components/gm_server_components.hpp"
 
+#include <common/system/gm_jobs.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace game {
     class World {
@@ -17,15 +32,117 @@ namespace game {
             World &operator=(World&&) = delete;
 
             // Functions
+            // Opens the world saved in @p world under WORLD_DIRECTORY and loads its entities. Chunks are read from it
+            // as they are loaded, and generated from the world's seed if they were never saved. New worlds get a random
+            // seed.
             void load(const std::string& world);
+            // Runs a tick: entities, then chunk loading, block ticks and light. Starts an autosave every AUTOSAVE_INTERVAL
+            // ticks.
             void update();
+            // Writes every changed chunk and the entities, and waits until they are written.
             void save();
+            // Snapshots the chunks and entities that changed since the last save, then writes them on Jobs while the
+            // world keeps ticking. Snapshots share chunk sections until they are next written to, so this only costs
+            // copying pointers and entity transforms.
+            // @return False if the previous save is still being written, in which case nothing is saved
+            bool startSave();
+            bool saving() const { return _saving != nullptr; }
+
+            // Sets the chunks players are in. Chunks within VIEW_DISTANCE of a player are loaded in the background,
+            // nearest first, and chunks further than UNLOAD_DISTANCE from every player are unloaded.
+            void setPlayerChunks(std::vector<ChunkPos>&& players);
+
+            // Reads the chunk at @p pos from the world's region files, waiting on the read. Ticks should leave loading
+            // to setPlayerChunks() instead. A chunk that is already loaded is left as it is.
+            // @return False if it has not been saved, or could not be read
+            bool loadChunk(const ChunkPos pos);
+            // Unloads the chunk at @p pos. If it changed, it is written by the next save, and loadChunk() returns it
+            // until then.
+            void unloadChunk(const ChunkPos pos);
 
+            // @return The block at world coordinates, or air if its chunk is not loaded
+            BlockID getBlock(const int32_t x, const int32_t y, const int32_t z) const { return _chunks.getBlock(x, y, z); }
+            // Sets a block and queues it to be relit by the next tick.
+            // @return False if the block's chunk is not loaded
+            bool setBlock(const int32_t x, const int32_t y, const int32_t z, const BlockID block);
+            // Ticks the block at world coordinates after @p delay ticks, through its BlockInfo::tick. The block there when
+            // the tick is due is the one ticked, and ticks for chunks unloaded in the meantime are dropped.
+            // @return False if the block already has a tick waiting, which is kept instead
+            bool scheduleTick(const int32_t x, const int32_t y, const int32_t z, const uint64_t delay) {
+                return _blockTicks.schedule(x, y, z, delay);
+            }
+            // @return The light of @p channel at world coordinates
+            uint8_t getLight(const uint32_t channel, const int32_t x, const int32_t y, const int32_t z) const {
+                return _light.light(channel, x, y, z);
+            }
+
+            // Blocks set through the map directly are not relit, so use setBlock() for blocks in loaded chunks
+            ChunkMap& chunks() { return _chunks; }
+            LightEngine& light() { return _light; }
+            // @return The loader for chunks around players, or nullptr if no world is loaded
+            ChunkLoader* loader() { return _loader.get(); }
             ServerComponents& serverComponents() { return _serverComponents; }
+            // @return The generator for chunks that were never saved, or nullptr if no world is loaded
+            const TerrainGenerator* generator() const { return _generator.get(); }
+
+            // Variables
+            static constexpr const char* WORLD_DIRECTORY = "../saves/";
+            static constexpr const char* ENTITIES_FILE = "/entities.gme";
+            static constexpr const char* LEVEL_FILE = "/level.gml"; // Settings fixed when the world is created, like the seed
+            static constexpr uint64_t AUTOSAVE_INTERVAL = 60 * 20; // Ticks between autosaves
+            static constexpr size_t SAVE_GRAIN = 16; // Chunks written per job
+            static constexpr int32_t VIEW_DISTANCE = 8; // In chunks
+            static constexpr int32_t UNLOAD_DISTANCE = VIEW_DISTANCE + 2; // Far enough that walking back and forth does not reload chunks
+            static constexpr size_t MAX_CHUNKS_PER_TICK = 16; // Loaded chunks added per tick
+            static constexpr uint32_t RANDOM_TICKS_PER_SECTION = 3; // Blocks picked for a random tick per section per tick
 
         private:
+            // Types
+            // The writes started by one save, which may outlive the tick that started them
+            typedef struct SaveBatch_ {
+                JobHandle done; // Finishes once every write is done
+                std::vector<std::shared_ptr<const Chunk>> chunks; // Released with the batch, on the tick thread
+                std::vector<std::pair<ChunkPos, std::shared_ptr<const Chunk>>> unloaded;
+                std::mutex mtx;
+                std::vector<ChunkPos> failed; // Chunks that could not be written
+                bool entitiesFailed = false;
+            } SaveBatch;
+
+            // Functions
+            // Once the current save is written, forgets the unloaded chunks it wrote and marks what failed to be saved
+            // again by the next one.
+            void finishSave();
+            void loadEntities();
+            // @return The seed of the world, which is chosen and saved if the world is new
+            uint64_t loadSeed();
+            // Adds the chunks the loader finished, and loads and unloads chunks as players move.
+            void updateChunks();
+            // Runs the scheduled ticks that are due, then random ticks in the sections with blocks that have them.
+            void tickBlocks();
+            // Moves the unloaded chunk at @p pos back into the world if it has not been written yet.
+            // @return False if it is not waiting to be written
+            bool restoreUnloaded(const ChunkPos pos);
+
             // Variables
             EntityPool& _entityPool;
             ServerComponents _serverComponents{_entityPool};
+            ChunkMap _chunks;
+            LightEngine _light{_chunks};
+            TickWheel _blockTicks;
+            std::vector<ScheduledTick> _dueTicks;
+            std::mt19937 _random{std::random_device{}()}; // Picks random ticks
+            std::string _directory;
+            std::unique_ptr<RegionStorage> _regions; // Set once a world is loaded
+            std::unique_ptr<TerrainGenerator> _generator;
+            std::unique_ptr<ChunkLoader> _loader; // Set with _regions, and reset first since it reads from them
+            std::vector<ChunkPos> _players;
+            bool _playersChanged = false;
+
+            std::shared_ptr<SaveBatch> _saving; // The save being written, if any
+            std::unordered_map<ChunkPos, std::shared_ptr<const Chunk>, ChunkPosHash> _unloaded; // Unloaded, not yet written
+            bool _entitiesChanged = false;
+            size_t _savedEntities = 0; // Transforms in the last entity snapshot
+            uint64_t _ticks = 0;
+            uint64_t _nextAutosave = AUTOSAVE_INTERVAL;
     };
-}
\ No newline at end of file
+}